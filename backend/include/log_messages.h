@@ -0,0 +1,33 @@
+#ifndef LOG_MESSAGES_H
+#define LOG_MESSAGES_H
+
+// Message templates for log_message_fmt(). A step logged with a template
+// stores only its id and integer arguments; the text is formatted when the
+// step is written (JSON/NDJSON), or the binary trace carries the template
+// once and the arguments per step. The only conversions are %d (one int
+// argument each) and %%.
+#define LOG_MESSAGE_TEMPLATES(X)                                                  \
+    X(MSG_MERGE_RANGES, "Merging ranges [%d..%d] and [%d..%d]")                   \
+    X(MSG_MERGE_COMPARE, "Comparing L:%d and R:%d for position %d")               \
+    X(MSG_QUICK_PARTITION, "Partitioning range [%d..%d] using Pivot %d")          \
+    X(MSG_QUICK_COMPARE, "Comparing %d with Pivot %d")                            \
+    X(MSG_RQUICK_PARTITION, "Partitioning with Pivot %d")                         \
+    X(MSG_BUBBLE_COMPARE, "Comparing %d and %d")                                  \
+    X(MSG_BUBBLE_SWAP, "Swapping %d and %d")                                      \
+    X(MSG_SELECTION_SEARCH, "Searching for minimum starting from index %d")       \
+    X(MSG_SELECTION_COMPARE, "Comparing %d with current min %d")                  \
+    X(MSG_SELECTION_SWAP, "Swapped %d and %d")                                    \
+    X(MSG_INSERTION_PICK, "Picked key: %d. Inserting into sorted portion...")     \
+    X(MSG_INSERTION_SHIFT, "%d > %d, moving %d right")                            \
+    X(MSG_INSERTION_INSERT, "Inserted key %d at position %d")                     \
+    X(MSG_COUNTING_COUNT, "Counting %d. Count[%d] = %d")                          \
+    X(MSG_RADIX_DIGIT, "Sorted by digit at exp %d")
+
+typedef enum {
+#define LOG_MESSAGE_ID(id, text) id,
+    LOG_MESSAGE_TEMPLATES(LOG_MESSAGE_ID)
+#undef LOG_MESSAGE_ID
+    LOG_MESSAGE_COUNT
+} LogMessageId;
+
+#endif // LOG_MESSAGES_H
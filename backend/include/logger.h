@@ -5,7 +5,66 @@
 #include <stdlib.h>
 #include <string.h>
 
-// Initialize the logger
+#include "log_messages.h"
+
+// Operation counters. Algorithms count their work with log_count_*(n);
+// every step then carries what was counted since the previous step ("ops")
+// and since log_init() ("ops_total"), and the trace ends with a summary
+// record of the totals. Steps before the first counted operation carry
+// neither. The counters belong to the calling thread: a trace reports what
+// was counted on its thread since its log_init() / log_ctx_init(), so
+// traces written one after another on a thread keep their counts apart,
+// but contexts interleaved on one thread each include the other's counts.
+// They compile away at LOG_LEVEL 0 unless LOG_COUNT_OPS is defined
+// (tools/bench_sort.c counts the headless sort kernels that way).
+typedef struct {
+    long long comparisons;
+    long long swaps;  // element exchanges
+    long long reads;  // array element reads
+    long long writes; // array element writes, moves included
+} LogOps;
+
+extern _Thread_local LogOps log_ops;
+
+// Compile-time trace level, set with -DLOG_LEVEL=N:
+//   2  full traces (default)
+//   1  steps carry only their message and tree nodes/edges; the array,
+//      variable and highlight calls compile away
+//   0  headless: every logging call compiles away, arguments included, and
+//      the program prints its wall time and a result checksum instead of a
+//      trace (see log_headless.h; `make headless` builds these)
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 2
+#endif
+
+// Initialize the logger.
+// Trace options are read from the environment:
+//   LOG_FORMAT=binary  write the compact binary format from trace_format.h
+//                      instead of JSON (decode with tools/tracecat)
+//   LOG_FORMAT=ndjson  write each step as one JSON object per line, flushed
+//                      as soon as the step ends
+//   LOG_DELTA=1        emit only changed array indices between keyframes, and
+//                      only the tree nodes/edges added by each step
+//                      ("nodes_added"/"edges_added")
+//   LOG_KEYFRAME=K     write a full keyframe every K steps in delta mode (default 64)
+//   LOG_MAX_STEPS=N    write at most N steps, thinning long runs evenly; a
+//                      trailing {"summary": {...}} element reports the steps
+//                      logged, kept and dropped. NDJSON writes the kept steps
+//                      as they come, thinning more the longer the run gets
+//   LOG_COMPRESS=gzip  gzip the whole output stream (needs a logger built
+//                      with LOGGER_ZLIB, linked with -lz)
+//   LOG_SUMMARY=trailer  (JSON) write the summary after the trace instead of
+//                      as its last element, uncompressed, as the summary
+//                      object followed by its length (u32, little-endian)
+//                      and "TSUM"; the trace stays a plain array of steps
+//   LOG_TIMING=1       time the run with CLOCK_MONOTONIC: each step gets
+//                      "timing": {"start_ns", "algorithm_ns"} (time since
+//                      log_init(), and time spent outside the logger since
+//                      the previous step), and the summary element gives the
+//                      algorithm and logger totals with per-step p50/p90/
+//                      p99/max
+// Output is buffered and written to stdout in large chunks; it is flushed by
+// log_finish() (or at exit).
 void log_init();
 
 // Log the start of a step. Call this before logging any state for a new step.
@@ -15,8 +74,24 @@ void log_step_start();
 // name: Name of the array variable (e.g., "nums")
 // arr: Pointer to the array
 // size: Size of the array
+// The contents are copied into the current step, so arr may change afterwards.
+// There is no limit on the size or number of arrays, variables and highlights.
 void log_array(const char* name, int* arr, int size);
 
+// Watch an array for the rest of the run.
+// Every following step includes the array's contents at log_step_end(), as
+// if log_array() had been called with it first thing in the step, but
+// nothing is copied per step; only the parts that changed are re-serialized.
+// arr must stay valid until log_unwatch_array() or log_finish(). Watching a
+// name again updates the pointer and size. A log_array() call with the same
+// name takes precedence for that step. With a step budget (LOG_MAX_STEPS)
+// the last step is only written by log_finish() and reads watched arrays
+// then, so changes made after the last log_step_end() show up in it.
+void log_watch_array(const char* name, int* arr, int size);
+
+// Stop watching an array registered with log_watch_array().
+void log_unwatch_array(const char* name);
+
 // Log a single integer variable.
 // name: Name of the variable (e.g., "target")
 // value: Value of the variable
@@ -30,10 +105,17 @@ void log_highlight(const char* name, int index);
 // Log a message/comment for the current step.
 void log_message(const char* message);
 
+// Log a message from a template in log_messages.h, with one int argument per
+// %d: log_message_fmt(MSG_BUBBLE_COMPARE, a, b). Cheaper than formatting
+// with sprintf() and log_message(): the text is only built for steps that
+// are written, and binary traces store just the arguments.
+void log_message_fmt(int template_id, ...);
+
 // Finish the current step. Call this after logging all state for the step.
 void log_step_end();
 
-// Log a tree/graph node (for recursion trees)
+// Log a tree/graph node (for recursion trees). Nodes and edges persist
+// across steps; logging an existing id (or from/to pair) again is a no-op.
 void log_node(int id, const char* label);
 
 // Log an edge (for recursion trees/graphs)
@@ -42,4 +124,189 @@ void log_edge(int from_id, int to_id);
 // Finalize the logger (closes JSON structure)
 void log_finish();
 
+// Entry point of a program: int ALGORITHM_MAIN(bubble_sort) { ... }, with
+// the program's name ('-' spelled '_'). It is main() when the program is
+// built on its own. Built with -DALGORITHM_MULTICALL, for the binaries that
+// link every program (build/algoviz, build/runner; see tools/multicall.h),
+// it is algorithm_main_<name>().
+#ifdef ALGORITHM_MULTICALL
+#define ALGORITHM_MAIN(name) algorithm_main_##name(int argc, char* argv[])
+#else
+#define ALGORITHM_MAIN(name) main(int argc, char* argv[])
+#endif
+
+// Self-description. Every program starts its entry point with
+//   if (log_describe(argc, argv, &description)) return 0;
+// so that `<program> --describe` prints what it accepts instead of a trace,
+// as one line of JSON (server.js validates requests against it):
+//   {"cost": "quadratic", "deterministic": true, "inputs": [
+//    {"name": "target", "type": "int"},
+//    {"name": "nums", "type": "int_args", "max_items": 100}]}
+typedef enum {
+    LOG_INPUT_INT,      // one integer argument
+    LOG_INPUT_INT_ARGS, // the remaining arguments, one integer each
+    LOG_INPUT_INT_LIST, // the same, or one argument of integers separated
+                        // by commas/spaces
+    LOG_INPUT_TREE,     // the remaining arguments, integers or "null" in
+                        // level order
+    LOG_INPUT_STRING    // one argument of text
+} LogInputType;
+
+typedef struct {
+    const char* name;
+    LogInputType type;
+    int min, max;        // range of the integer values; both 0 for any int
+    int max_size;        // most values (lists, trees) or characters (strings)
+    const char* charset; // the characters a string may contain
+} LogInput;
+
+// How the running time grows with the size of the input.
+typedef enum {
+    LOG_COST_LOGARITHMIC,
+    LOG_COST_LINEAR,
+    LOG_COST_LINEARITHMIC,
+    LOG_COST_QUADRATIC,
+    LOG_COST_EXPONENTIAL
+} LogCost;
+
+typedef struct {
+    LogCost cost;
+    int nondeterministic;   // the trace differs between runs on one input
+    const LogInput* inputs; // in argument order
+    int input_count;
+} LogDescription;
+
+// Prints description and returns 1 when the only argument is --describe;
+// returns 0 otherwise.
+int log_describe(int argc, char* argv[], const LogDescription* description);
+
+// Re-entrant API. All logger state lives in a LogCtx, so several traces can
+// be written at the same time: one context per thread, or several
+// interleaved on one thread (their operation counts then overlap, see
+// LogOps). A context is used by one thread at a time.
+//
+// Each log_X() function above has a log_ctx_X(ctx, ...) twin, and works on
+// the calling thread's default context: the one bound with log_bind_ctx(),
+// or else one that log_init() creates from the environment (writing to
+// stdout) and log_finish() destroys.
+typedef struct LogCtx LogCtx;
+
+// Receives the serialized trace in large chunks (the whole stream, gzipped
+// when asked for). user is the pointer given to log_ctx_create().
+typedef void (*LogSink)(void* user, const void* data, size_t len);
+
+enum {
+    LOG_FORMAT_JSON = 0,
+    LOG_FORMAT_NDJSON = 1,
+    LOG_FORMAT_BINARY = 2
+};
+
+// Trace options; all zeros is a plain JSON trace. See log_init() for what
+// each one does.
+typedef struct {
+    int format;            // LOG_FORMAT_*
+    int delta;             // LOG_DELTA
+    int keyframe_interval; // LOG_KEYFRAME, 0 for the default
+    long max_steps;        // LOG_MAX_STEPS, 0 for no budget
+    int gzip;              // LOG_COMPRESS=gzip
+    int summary_trailer;   // LOG_SUMMARY=trailer
+    int timing;            // LOG_TIMING
+} LogOptions;
+
+// Fill options from the LOG_* environment variables, as log_init() does.
+void log_options_from_env(LogOptions* options);
+
+// Set the option of one LOG_* variable from its value, as if read from the
+// environment. Returns 0 for an unknown name.
+int log_option_set(LogOptions* options, const char* name, const char* value);
+
+// Create a context writing to sink (stdout when NULL) with the given options
+// (defaults when NULL). The context can write any number of traces in turn,
+// each from log_ctx_init() to log_ctx_finish(), and keeps its buffers
+// between them.
+LogCtx* log_ctx_create(const LogOptions* options, LogSink sink, void* user);
+
+// Flush and free a context.
+void log_ctx_destroy(LogCtx* ctx);
+
+// Called when the logger cannot go on (out of memory, no gzip support)
+// instead of exiting the process; it must not return. The handler is per
+// thread (NULL: print the reason and exit(1)). A host running several traces
+// in one process (tools/runner.c) longjmp()s out of the algorithm, fails
+// that one run and replaces the context with log_ctx_abandon(): whatever
+// the algorithm had allocated is lost.
+typedef void (*LogFailureHandler)(const char* reason);
+void log_on_failure(LogFailureHandler handler);
+
+// Free a context the logger failed on, without writing anything more.
+void log_ctx_abandon(LogCtx* ctx);
+
+// Replace the options of a context; they apply from the next log_ctx_init().
+void log_ctx_set_options(LogCtx* ctx, const LogOptions* options);
+
+// Make ctx the calling thread's default context (NULL to go back to the
+// environment-configured one). The caller still owns ctx.
+void log_bind_ctx(LogCtx* ctx);
+
+// The calling thread's default context, or NULL outside log_init()/log_finish()
+// when none is bound.
+LogCtx* log_current_ctx();
+
+void log_ctx_init(LogCtx* ctx);
+void log_ctx_step_start(LogCtx* ctx);
+void log_ctx_array(LogCtx* ctx, const char* name, int* arr, int size);
+void log_ctx_watch_array(LogCtx* ctx, const char* name, int* arr, int size);
+void log_ctx_unwatch_array(LogCtx* ctx, const char* name);
+void log_ctx_var(LogCtx* ctx, const char* name, int value);
+void log_ctx_highlight(LogCtx* ctx, const char* name, int index);
+void log_ctx_message(LogCtx* ctx, const char* message);
+void log_ctx_message_fmt(LogCtx* ctx, int template_id, ...);
+void log_ctx_step_end(LogCtx* ctx);
+void log_ctx_node(LogCtx* ctx, int id, const char* label);
+void log_ctx_edge(LogCtx* ctx, int from_id, int to_id);
+void log_ctx_finish(LogCtx* ctx);
+
+// log_result(data, size) records the program's result for the LOG_LEVEL 0
+// checksum (the values are read at the call); it does nothing at the other
+// levels.
+#if LOG_LEVEL <= 1
+#define log_array(name, arr, size) ((void)0)
+#define log_var(name, value) ((void)0)
+#define log_highlight(name, index) ((void)0)
+#define log_unwatch_array(name) ((void)0)
+#endif
+
+#if LOG_LEVEL == 1
+#define log_watch_array(name, arr, size) ((void)0)
+#endif
+
+#if LOG_LEVEL <= 0 && !defined(LOG_COUNT_OPS)
+#define log_count_compare(n) ((void)0)
+#define log_count_swap(n) ((void)0)
+#define log_count_read(n) ((void)0)
+#define log_count_write(n) ((void)0)
+#else
+#define log_count_compare(n) ((void)(log_ops.comparisons += (n)))
+#define log_count_swap(n) ((void)(log_ops.swaps += (n)))
+#define log_count_read(n) ((void)(log_ops.reads += (n)))
+#define log_count_write(n) ((void)(log_ops.writes += (n)))
+#endif
+
+#if LOG_LEVEL <= 0
+#include "log_headless.h"
+#define log_init() log_headless_init()
+#define log_watch_array(name, arr, size) log_headless_watch(arr, size)
+#define log_finish() log_headless_finish()
+#define log_step_start() ((void)0)
+#define log_step_end() ((void)0)
+#define log_message(message) ((void)0)
+#define log_message_fmt(...) ((void)0)
+#define log_node(id, label) ((void)0)
+#define log_edge(from_id, to_id) ((void)0)
+#define log_result(data, size) log_headless_fold(data, size)
+#define log_describe(argc, argv, description) ((void)(description), 0)
+#else
+#define log_result(data, size) ((void)sizeof(data), (void)sizeof(size))
+#endif
+
 #endif // LOGGER_H
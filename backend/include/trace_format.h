@@ -0,0 +1,61 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+// Binary trace format (LOG_FORMAT=binary), shared by the logger and the
+// trace tools. All integers are little-endian.
+//
+//   header            "AVTR", u16 version, u16 flags (TRACE_FLAG_*)
+//   then records      u8 tag, payload
+//
+//   TRACE_REC_STRING  u32 length, bytes
+//                     Defines the next string id (ids count up from 0).
+//                     Names, labels and messages refer to strings by id.
+//   TRACE_REC_STEP    u8 step flags (TRACE_STEP_*)
+//                     u32 arrays      { u32 name, u8 column, u32 count, values }
+//                     u32 variables   { u32 name, i32 value }
+//                     u32 highlights  { u32 name, i32 index }
+//                     u32 nodes       { i32 id, u32 label }
+//                     u32 edges       { i32 from, i32 to }
+//                     u32 message
+//                     with TRACE_STEP_TEMPLATE, the message is a template
+//                     (see log_messages.h) followed by u32 count and count
+//                     x i32 arguments, one per %d
+//                     with TRACE_STEP_OPS, the operation counts since the
+//                     previous step and since the start: 2 x { i64
+//                     comparisons, i64 swaps, i64 reads, i64 writes }
+//                     with TRACE_STEP_TIMING, i64 start_ns, i64 algorithm_ns
+//   TRACE_REC_SUMMARY u32 count, count x { u32 name, i64 value }
+//                     Totals for the whole run (e.g. steps dropped under
+//                     LOG_MAX_STEPS), written just before TRACE_REC_END.
+//   TRACE_REC_END     no payload, last record of a complete trace
+//
+// Array values are stored as a column of count elements, each
+// TRACE_COL_I8/I16/I32 bytes wide (the narrowest width that holds every
+// value), or with TRACE_COL_DELTA as count (u32 index, i32 value) pairs
+// applied to the previous contents of the array.
+//
+// With TRACE_FLAG_DELTA the node and edge lists of a step hold only the
+// entries added since the previous step; the tree is rebuilt by
+// accumulating them from the first step (keyframes do not repeat it).
+
+#define TRACE_MAGIC "AVTR"
+#define TRACE_VERSION 6
+
+#define TRACE_FLAG_DELTA 0x0001
+
+#define TRACE_REC_STRING 0x01
+#define TRACE_REC_STEP 0x02
+#define TRACE_REC_SUMMARY 0x03
+#define TRACE_REC_END 0xff
+
+#define TRACE_STEP_KEYFRAME 0x01
+#define TRACE_STEP_TEMPLATE 0x02
+#define TRACE_STEP_OPS 0x04
+#define TRACE_STEP_TIMING 0x08
+
+#define TRACE_COL_I8 1
+#define TRACE_COL_I16 2
+#define TRACE_COL_I32 4
+#define TRACE_COL_DELTA 0x80
+
+#endif // TRACE_FORMAT_H
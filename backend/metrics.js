@@ -0,0 +1,146 @@
+// Metrics in the Prometheus text format, for GET /metrics, without a client
+// library: counters, gauges read at scrape time, and histograms. Histogram
+// buckets are log-spaced, HDR-style: each bound is a fixed ratio above the
+// one before, so the relative precision is the same for a 20µs spawn as for
+// a 4s run. Series appear once something is recorded under their labels.
+
+function escapeLabel(value) {
+    return String(value).replace(/\\/g, '\\\\').replace(/"/g, '\\"').replace(/\n/g, '\\n');
+}
+
+function formatLabels(names, values, extra = '') {
+    const pairs = names.map((name, i) => `${name}="${escapeLabel(values[i])}"`);
+    if (extra) pairs.push(extra);
+    return pairs.length ? `{${pairs.join(',')}}` : '';
+}
+
+// Bounds from min up to at least max, perOctave of them per doubling
+function logBuckets(min, max, perOctave) {
+    const bounds = [];
+    for (let i = 0; ; i++) {
+        const bound = Number((min * 2 ** (i / perOctave)).toPrecision(4));
+        bounds.push(bound);
+        if (bound >= max) return bounds;
+    }
+}
+
+class Metric {
+    constructor(name, help, labelNames) {
+        this.name = name;
+        this.help = help;
+        this.labelNames = labelNames;
+        this.series = new Map(); // label values joined with \0 -> series
+    }
+
+    seriesFor(labels, create) {
+        const values = this.labelNames.map(name => labels[name]);
+        const key = values.join('\0');
+        let series = this.series.get(key);
+        if (!series) {
+            series = { values, ...create() };
+            this.series.set(key, series);
+        }
+        return series;
+    }
+
+    header(type) {
+        return `# HELP ${this.name} ${this.help}\n# TYPE ${this.name} ${type}\n`;
+    }
+}
+
+class Counter extends Metric {
+    inc(labels = {}, n = 1) {
+        this.seriesFor(labels, () => ({ value: 0 })).value += n;
+    }
+
+    render() {
+        let text = this.header('counter');
+        for (const { values, value } of this.series.values()) {
+            text += `${this.name}${formatLabels(this.labelNames, values)} ${value}\n`;
+        }
+        return text;
+    }
+}
+
+class Gauge extends Metric {
+    constructor(name, help, read) {
+        super(name, help, []);
+        this.read = read;
+    }
+
+    render() {
+        return `${this.header('gauge')}${this.name} ${this.read()}\n`;
+    }
+}
+
+class Histogram extends Metric {
+    constructor(name, help, labelNames, { min, max, perOctave }) {
+        super(name, help, labelNames);
+        this.min = min;
+        this.perOctave = perOctave;
+        this.bounds = logBuckets(min, max, perOctave);
+    }
+
+    observe(labels, value) {
+        const series = this.seriesFor(labels, () => ({
+            counts: new Array(this.bounds.length + 1).fill(0),
+            sum: 0,
+            count: 0
+        }));
+        // The bucket index straight from the logarithm, then corrected for
+        // the rounding of the bounds
+        let i = value <= this.min ? 0 : Math.ceil(Math.log2(value / this.min) * this.perOctave);
+        i = Math.min(Math.max(i, 0), this.bounds.length);
+        while (i > 0 && value <= this.bounds[i - 1]) i--;
+        while (i < this.bounds.length && value > this.bounds[i]) i++;
+        series.counts[i]++;
+        series.sum += value;
+        series.count++;
+    }
+
+    render() {
+        let text = this.header('histogram');
+        for (const { values, counts, sum, count } of this.series.values()) {
+            let cumulative = 0;
+            this.bounds.forEach((bound, i) => {
+                cumulative += counts[i];
+                text += `${this.name}_bucket${formatLabels(this.labelNames, values, `le="${bound}"`)} ${cumulative}\n`;
+            });
+            text += `${this.name}_bucket${formatLabels(this.labelNames, values, 'le="+Inf"')} ${count}\n`;
+            text += `${this.name}_sum${formatLabels(this.labelNames, values)} ${sum}\n`;
+            text += `${this.name}_count${formatLabels(this.labelNames, values)} ${count}\n`;
+        }
+        return text;
+    }
+}
+
+class Metrics {
+    constructor() {
+        this.metrics = [];
+    }
+
+    add(metric) {
+        this.metrics.push(metric);
+        return metric;
+    }
+
+    counter(name, help, labelNames = []) {
+        return this.add(new Counter(name, help, labelNames));
+    }
+
+    // read() gives the current value at every scrape
+    gauge(name, help, read) {
+        return this.add(new Gauge(name, help, read));
+    }
+
+    // buckets: { min, max, perOctave }
+    histogram(name, help, labelNames, buckets) {
+        return this.add(new Histogram(name, help, labelNames, buckets));
+    }
+
+    render() {
+        return this.metrics.map(metric => metric.render()).join('');
+    }
+}
+
+module.exports = { Metrics };
@@ -0,0 +1,209 @@
+const { execFileSync } = require('child_process');
+const fs = require('fs');
+const path = require('path');
+
+// The algorithms the server runs and what each one accepts. The programs
+// describe themselves (`<program> --describe`, see log_describe() in
+// logger.h); build/algorithms.txt lists them. Everything is read once at
+// startup, so looking up and validating a request never touches the
+// filesystem. Restart the server after rebuilding.
+//
+// When build/algoviz is built, every algorithm runs from it (`algoviz
+// <algorithm> [arguments]`): one binary shared in the page cache by all the
+// algorithms, rather than a cold one per algorithm. An entry's file and
+// argv give the command: spawn(file, [...argv, ...arguments]).
+
+const INTEGER = /^\s*-?\d+\s*$/;
+
+// What the programs make of an integer argument: atoi() skips leading (C)
+// whitespace, takes a sign and digits and ignores the rest.
+const C_INTEGER = /^[ \t\n\v\f\r]*([+-]?)0*(\d*)/;
+
+// Input size assumed when the arguments are left to the program's defaults
+const DEFAULT_SIZE = 10;
+
+// Relative running time for an input of size n, by cost class
+const COST_GROWTH = {
+    logarithmic: n => Math.log2(n + 2),
+    linear: n => n + 1,
+    linearithmic: n => (n + 1) * Math.log2(n + 2),
+    quadratic: n => (n + 1) * (n + 1),
+    exponential: n => 2 ** Math.min(n, 60)
+};
+
+function describe(buildDir, name, multicall) {
+    const file = multicall ? path.join(buildDir, 'algoviz') : path.join(buildDir, name);
+    const argv = multicall ? [name] : [];
+    const stat = fs.statSync(file);
+    const description = JSON.parse(execFileSync(file, [...argv, '--describe'], { timeout: 5000 }));
+    return {
+        name,
+        file,
+        argv,
+        version: `${stat.size}:${stat.mtimeMs}`,
+        ...description
+    };
+}
+
+function checkInteger(input, value) {
+    if (!INTEGER.test(value)) {
+        return `Input '${input.name}' must be ${input.type === 'int' ? 'an integer' : 'a list of integers'}.`;
+    }
+    const n = Number(value);
+    if (input.min !== undefined && (n < input.min || n > input.max)) {
+        return `Input '${input.name}' must be between ${input.min} and ${input.max}.`;
+    }
+    return null;
+}
+
+// Arguments taken by a list input: the rest, or, for an int_list given as
+// one argument, its values (the program splits it on spaces and commas).
+function listItems(input, args) {
+    if (input.type === 'int_list' && args.length === 1) {
+        return args[0].split(/[ ,]+/).filter(item => item !== '');
+    }
+    return args;
+}
+
+// The value atoi() reads from an argument, spelled one way
+function canonicalInteger(value) {
+    const [, sign, digits] = C_INTEGER.exec(value);
+    return digits === '' ? '0' : `${sign === '-' ? '-' : ''}${digits}`;
+}
+
+function checkInput(input, args) {
+    switch (input.type) {
+        case 'int':
+            return checkInteger(input, args[0]);
+        case 'string':
+            if (args[0].length > input.max_length) {
+                return `Input '${input.name}' is too long. Maximum ${input.max_length} characters.`;
+            }
+            if (input.charset !== undefined && ![...args[0]].every(c => input.charset.includes(c))) {
+                return `Input '${input.name}' may only contain: ${input.charset}`;
+            }
+            return null;
+        default: {
+            const items = listItems(input, args);
+            if (input.max_items !== undefined && items.length > input.max_items) {
+                return `Input '${input.name}' takes at most ${input.max_items} values.`;
+            }
+            for (const item of items) {
+                if (input.type === 'tree' && item.trim() === 'null') continue;
+                const error = checkInteger(input, item);
+                if (error) return error;
+            }
+            return null;
+        }
+    }
+}
+
+class Registry {
+    constructor(buildDir) {
+        this.buildDir = buildDir;
+        this.algorithms = new Map();
+    }
+
+    load() {
+        let names;
+        try {
+            names = fs.readFileSync(path.join(this.buildDir, 'algorithms.txt'), 'utf8').split('\n').filter(Boolean);
+        } catch {
+            console.error('No build/algorithms.txt: run `make` first. No algorithms are available.');
+            return this;
+        }
+        const multicall = fs.existsSync(path.join(this.buildDir, 'algoviz'));
+        for (const name of names) {
+            try {
+                this.algorithms.set(name, describe(this.buildDir, name, multicall));
+            } catch (err) {
+                console.error(`Algorithm '${name}' is not available:`, err.message);
+            }
+        }
+        return this;
+    }
+
+    get(name) {
+        return this.algorithms.get(name);
+    }
+
+    // The descriptions, by algorithm name
+    describeAll() {
+        const all = {};
+        for (const { name, cost, deterministic, inputs } of this.algorithms.values()) {
+            all[name] = { cost, deterministic, inputs };
+        }
+        return all;
+    }
+
+    // Checks arguments against the algorithm's inputs, which take them in
+    // order (lists take the rest). Trailing inputs may be left out: the
+    // programs have defaults. Returns an error message, or null.
+    validate(algorithm, args) {
+        let next = 0;
+        for (const input of algorithm.inputs) {
+            if (next === args.length) return null;
+            const scalar = input.type === 'int' || input.type === 'string';
+            const taken = scalar ? args.slice(next, next + 1) : args.slice(next);
+            const error = checkInput(input, taken);
+            if (error) return error;
+            next += taken.length;
+        }
+        if (next < args.length) {
+            return `Too many inputs. '${algorithm.name}' takes ${algorithm.inputs.length}.`;
+        }
+        return null;
+    }
+
+    // Validated arguments spelled one way, for cache keys: spellings the
+    // program reads as the same input get the same arguments. An int_list
+    // becomes one comma-separated argument whether it came as "5,3,8",
+    // "5, 3, 08" or 5 3 8.
+    canonicalArgs(algorithm, args) {
+        const canonical = [];
+        let next = 0;
+        for (const input of algorithm.inputs) {
+            if (next === args.length) break;
+            if (input.type === 'int') {
+                canonical.push(canonicalInteger(args[next++]));
+            } else if (input.type === 'string') {
+                canonical.push(args[next++]);
+            } else {
+                const items = listItems(input, args.slice(next));
+                if (input.type === 'int_list') {
+                    canonical.push(items.map(canonicalInteger).join(','));
+                } else {
+                    // The tree program takes "null" only as it is
+                    canonical.push(...items.map(item => (input.type === 'tree' && item === 'null' ? item : canonicalInteger(item))));
+                }
+                next = args.length;
+            }
+        }
+        return canonical;
+    }
+
+    // Estimated relative cost of running the algorithm on (validated)
+    // arguments: its cost class applied to the input size, which is the
+    // number of list or tree values or the length of the string, or else the
+    // largest integer argument (fibonacci's n, n_queens' board size).
+    estimateCost(algorithm, args) {
+        let size = null;
+        let largest = null;
+        let next = 0;
+        for (const input of algorithm.inputs) {
+            if (next === args.length) break;
+            if (input.type === 'int') {
+                largest = Math.max(largest ?? 0, Math.abs(Number(args[next++])));
+            } else if (input.type === 'string') {
+                size = Math.max(size ?? 0, args[next++].length);
+            } else {
+                size = Math.max(size ?? 0, listItems(input, args.slice(next)).length);
+                next = args.length;
+            }
+        }
+        const growth = COST_GROWTH[algorithm.cost] || COST_GROWTH.linear;
+        return growth(size ?? largest ?? DEFAULT_SIZE);
+    }
+}
+
+module.exports = { Registry };
@@ -0,0 +1,180 @@
+const { spawn } = require('child_process');
+
+// Client for build/runner (tools/runner.c): one long-lived process with every
+// algorithm linked in, taking length-prefixed requests on stdin and
+// streaming the traces back on stdout. A RunnerPool keeps a few of them
+// running and spreads requests over them.
+
+// LOG_* settings the runner understands; the programs it runs do not see
+// its environment, so these are sent with every request.
+const LOG_OPTIONS = ['LOG_FORMAT', 'LOG_DELTA', 'LOG_KEYFRAME', 'LOG_MAX_STEPS', 'LOG_COMPRESS', 'LOG_TIMING', 'LOG_SUMMARY'];
+
+class RunnerError extends Error {
+    constructor(code, message) {
+        super(message);
+        this.code = code; // TIMEOUT, TOO_LARGE, REJECTED or RUNNER_EXITED
+    }
+}
+
+function encodeRequest(id, algorithm, options, args) {
+    const fields = [id, algorithm, ...options, '', ...args];
+    const body = Buffer.from(fields.map(field => `${field}\0`).join(''));
+    const header = Buffer.alloc(4);
+    header.writeUInt32LE(body.length, 0);
+    return Buffer.concat([header, body]);
+}
+
+class Runner {
+    constructor(runnerPath, threads, onExit) {
+        this.pending = new Map();
+        this.nextId = 0;
+        this.chunks = [];
+        this.buffered = 0;
+        this.needed = 4;
+        this.alive = true;
+
+        this.child = spawn(runnerPath, ['--threads', String(threads)], { stdio: ['pipe', 'pipe', 'inherit'] });
+        this.child.stdout.on('data', chunk => this.onData(chunk));
+        this.child.stdin.on('error', () => {}); // the exit handler fails what is pending
+        this.child.on('error', err => {
+            console.error('Runner failed:', err.message);
+            this.onExit(onExit);
+        });
+        this.child.on('exit', () => this.onExit(onExit));
+    }
+
+    // Runs an algorithm; resolves with { status, stdout } once it returns.
+    run(algorithm, args, env, { timeout, maxOutput }) {
+        return new Promise((resolve, reject) => {
+            const id = String(this.nextId++);
+            const options = LOG_OPTIONS.filter(name => env[name] !== undefined).map(name => `${name}=${env[name]}`);
+            // The runner stops a run whose trace goes over the limit
+            options.push(`MAX_OUTPUT=${maxOutput}`);
+            const request = { chunks: [], size: 0, resolve, reject, failed: false };
+            // Armed until the runner says the run is over, even once the
+            // request has failed: a thread cannot be stopped from the
+            // outside, so one that runs on costs the whole runner, and the
+            // pool starts a new one.
+            request.timer = setTimeout(() => {
+                this.fail(request, new RunnerError('TIMEOUT', 'Execution timeout'));
+                this.kill();
+            }, timeout);
+            request.maxOutput = maxOutput;
+            this.pending.set(id, request);
+            this.child.stdin.write(encodeRequest(id, algorithm, options, args));
+        });
+    }
+
+    kill() {
+        if (this.alive) this.child.kill('SIGKILL');
+    }
+
+    // Rejects the request; its thread may still be running (see run()).
+    fail(request, error) {
+        if (request.failed) return;
+        request.failed = true;
+        request.chunks = [];
+        request.reject(error);
+    }
+
+    onData(chunk) {
+        this.chunks.push(chunk);
+        this.buffered += chunk.length;
+        if (this.buffered < this.needed) return;
+
+        // Enough for at least one frame: join once and take all complete ones.
+        const data = Buffer.concat(this.chunks, this.buffered);
+        let offset = 0;
+        while (data.length - offset >= 4) {
+            const length = data.readUInt32LE(offset);
+            if (data.length - offset < 4 + length) break;
+            this.onFrame(data.subarray(offset + 4, offset + 4 + length));
+            offset += 4 + length;
+        }
+        const rest = data.subarray(offset);
+        this.chunks = rest.length > 0 ? [rest] : [];
+        this.buffered = rest.length;
+        this.needed = rest.length >= 4 ? 4 + rest.readUInt32LE(0) : 4;
+    }
+
+    onFrame(frame) {
+        const end = frame.indexOf(0);
+        const id = frame.toString('utf8', 0, end);
+        const type = String.fromCharCode(frame[end + 1]);
+        const payload = frame.subarray(end + 2);
+        const request = this.pending.get(id);
+        if (request === undefined) return;
+
+        if (type === 'D') {
+            if (request.failed) return;
+            request.size += payload.length;
+            if (request.size > request.maxOutput) {
+                this.fail(request, new RunnerError('TOO_LARGE', 'Trace too large'));
+                return;
+            }
+            // Copy: payload points into a buffer that is reused for the
+            // next frames.
+            request.chunks.push(Buffer.from(payload));
+            return;
+        }
+
+        this.pending.delete(id);
+        clearTimeout(request.timer);
+        if (type === 'E') {
+            if (request.failed) return;
+            request.resolve({ status: parseInt(payload.toString(), 10), stdout: Buffer.concat(request.chunks, request.size) });
+        } else {
+            this.fail(request, new RunnerError('REJECTED', payload.toString()));
+        }
+    }
+
+    onExit(onExit) {
+        if (!this.alive) return;
+        this.alive = false;
+        for (const request of this.pending.values()) {
+            clearTimeout(request.timer);
+            this.fail(request, new RunnerError('RUNNER_EXITED', 'Runner exited'));
+        }
+        this.pending.clear();
+        onExit(this);
+    }
+}
+
+class RunnerPool {
+    constructor(runnerPath, { size, threads }) {
+        this.runnerPath = runnerPath;
+        this.size = size;
+        this.threads = threads;
+        this.runners = [];
+    }
+
+    // The least busy runner, starting runners up to the pool size.
+    pick() {
+        if (this.runners.length < this.size) {
+            const runner = new Runner(this.runnerPath, this.threads, exited => {
+                this.runners = this.runners.filter(r => r !== exited);
+            });
+            this.runners.push(runner);
+            return runner;
+        }
+        return this.runners.reduce((best, r) => (r.pending.size < best.pending.size ? r : best));
+    }
+
+    // Runs algorithm with args; resolves with { status, stdout }. A request
+    // that was in flight on a runner that crashed or was killed for another
+    // request's timeout is retried once.
+    async run(algorithm, args, env, limits) {
+        try {
+            return await this.pick().run(algorithm, args, env, limits);
+        } catch (err) {
+            if (err.code !== 'RUNNER_EXITED') throw err;
+            return this.pick().run(algorithm, args, env, limits);
+        }
+    }
+
+    close() {
+        for (const runner of this.runners) runner.child.stdin.end();
+    }
+}
+
+module.exports = { RunnerPool, RunnerError };
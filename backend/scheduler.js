@@ -0,0 +1,144 @@
+const { performance } = require('perf_hooks');
+
+// Admission control for program runs. At most `slots` runs execute at once;
+// the others wait in a queue of at most `maxQueue`, cheapest estimated cost
+// first (oldest first among equals), for at most `maxWait` ms. Beyond that a
+// request is turned away at once instead of adding another process:
+//   429  the queue is full of runs no more expensive than this one
+//   503  the run waited maxWait ms without a slot, or a cheaper run took
+//        its place in a full queue
+// Both come with a Retry-After estimate from recent run times.
+
+const WAIT_SAMPLES = 1024; // recent queue waits kept for the percentiles
+
+function percentile(sorted, p) {
+    if (sorted.length === 0) return 0;
+    return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+class Scheduler {
+    constructor({ slots, maxQueue, maxWait }) {
+        this.slots = slots;
+        this.maxQueue = maxQueue;
+        this.maxWait = maxWait;
+        this.running = 0;
+        this.queue = []; // waiters, by cost then arrival
+        this.nextSeq = 0;
+        this.runTime = 0; // moving average of how long a slot is held, ms
+        this.waits = [];
+        this.nextWait = 0;
+        this.counters = { admitted: 0, queued: 0, rejected_full: 0, rejected_timeout: 0, shed: 0, cancelled: 0 };
+    }
+
+    // Seconds a turned-away client should wait: the queue's share of the
+    // slots, at the recent run time
+    retryAfter() {
+        return Math.max(1, Math.ceil((this.queue.length + 1) / this.slots * this.runTime / 1000));
+    }
+
+    rejection(status, error, details) {
+        return { status, body: { error, details }, retryAfter: this.retryAfter() };
+    }
+
+    // Resolves with a release() function once a slot is free; call it when
+    // the run is over. Rejects with { status, body, retryAfter } when the run
+    // is not admitted. Aborting signal (optional) takes a waiting run out of
+    // the queue.
+    acquire(cost, signal) {
+        if (signal?.aborted) {
+            return Promise.reject({ status: 499, body: { error: 'Request cancelled' } });
+        }
+        if (this.running < this.slots && this.queue.length === 0) {
+            return Promise.resolve(this.grant(0));
+        }
+        if (this.queue.length >= this.maxQueue) {
+            const last = this.queue[this.queue.length - 1];
+            if (!last || last.cost <= cost) {
+                this.counters.rejected_full++;
+                return Promise.reject(this.rejection(429, 'Server busy',
+                    `All ${this.slots} execution slots are in use and ${this.queue.length} runs are waiting.`));
+            }
+            this.remove(last);
+            this.counters.shed++;
+            last.reject(this.rejection(503, 'Server busy', 'Displaced from the queue by cheaper runs.'));
+        }
+
+        return new Promise((resolve, reject) => {
+            const waiter = { cost, seq: this.nextSeq++, since: performance.now(), resolve, reject, signal };
+            waiter.timer = setTimeout(() => {
+                this.remove(waiter);
+                this.counters.rejected_timeout++;
+                reject(this.rejection(503, 'Server busy',
+                    `No execution slot became free within ${this.maxWait / 1000} seconds.`));
+            }, this.maxWait);
+            if (signal) {
+                waiter.onAbort = () => {
+                    this.remove(waiter);
+                    this.counters.cancelled++;
+                    reject({ status: 499, body: { error: 'Request cancelled' } });
+                };
+                signal.addEventListener('abort', waiter.onAbort, { once: true });
+            }
+
+            let at = this.queue.length;
+            while (at > 0 && this.queue[at - 1].cost > cost) at--;
+            this.queue.splice(at, 0, waiter);
+            this.counters.queued++;
+        });
+    }
+
+    remove(waiter) {
+        clearTimeout(waiter.timer);
+        if (waiter.onAbort) waiter.signal.removeEventListener('abort', waiter.onAbort);
+        const at = this.queue.indexOf(waiter);
+        if (at >= 0) this.queue.splice(at, 1);
+    }
+
+    grant(wait) {
+        this.running++;
+        this.counters.admitted++;
+        this.waits[this.nextWait] = wait;
+        this.nextWait = (this.nextWait + 1) % WAIT_SAMPLES;
+
+        const start = performance.now();
+        let released = false;
+        return () => {
+            if (released) return;
+            released = true;
+            this.running--;
+            const elapsed = performance.now() - start;
+            this.runTime = this.runTime === 0 ? elapsed : this.runTime * 0.9 + elapsed * 0.1;
+            this.dispatch();
+        };
+    }
+
+    dispatch() {
+        while (this.running < this.slots && this.queue.length > 0) {
+            const waiter = this.queue[0];
+            this.remove(waiter);
+            waiter.resolve(this.grant(performance.now() - waiter.since));
+        }
+    }
+
+    stats() {
+        const waits = [...this.waits].sort((a, b) => a - b);
+        const ms = value => Math.round(value * 1000) / 1000;
+        return {
+            slots: this.slots,
+            running: this.running,
+            queue_depth: this.queue.length,
+            max_queue: this.maxQueue,
+            max_wait_ms: this.maxWait,
+            ...this.counters,
+            wait_ms: {
+                p50: ms(percentile(waits, 0.5)),
+                p90: ms(percentile(waits, 0.9)),
+                p99: ms(percentile(waits, 0.99)),
+                max: ms(waits.length ? waits[waits.length - 1] : 0)
+            },
+            run_ms_avg: ms(this.runTime)
+        };
+    }
+}
+
+module.exports = { Scheduler };
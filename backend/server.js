@@ -1,8 +1,17 @@
 const express = require('express');
 const cors = require('cors');
-const { exec } = require('child_process');
+const { execFile, spawn } = require('child_process');
+const crypto = require('crypto');
+const { performance } = require('perf_hooks');
 const path = require('path');
 const fs = require('fs');
+const os = require('os');
+const { Metrics } = require('./metrics');
+const { Registry } = require('./registry');
+const { RunnerPool } = require('./runner_pool');
+const { Scheduler } = require('./scheduler');
+const { TraceCache, traceKey } = require('./trace_cache');
+const { TraceStore } = require('./trace_store');
 
 const app = express();
 const PORT = 3001;
@@ -11,13 +20,208 @@ const PORT = 3001;
 const EXECUTION_TIMEOUT = 5000; // 5 seconds max execution time
 const MAX_INPUT_LENGTH = 1000; // Maximum characters per input
 const MAX_INPUTS = 100; // Maximum number of inputs
+const MAX_STEPS = 2000; // Step budget passed to the logger (LOG_MAX_STEPS)
+const MAX_OUTPUT = 16 * 1024 * 1024; // 16MB of trace output
 
-app.use(cors());
+// Environment for the C programs. Of the server's own environment only
+// these variables are passed on: every LOG_* option a response depends on
+// is set below or by its endpoint, so a LOG_DELTA or LOG_FORMAT exported in
+// the server's shell cannot change the traces sent or cached. LOG_TIMING is
+// the exception, a deliberate server setting (see setSummaryHeaders()).
+const PASSED_ENV = ['PATH', 'LANG', 'LC_ALL', 'TZ', 'LOG_TIMING'];
+const BASE_ENV = Object.fromEntries(PASSED_ENV
+    .filter(name => process.env[name] !== undefined)
+    .map(name => [name, process.env[name]]));
+// Long runs are thinned to MAX_STEPS steps
+const RUN_ENV = { ...BASE_ENV, LOG_MAX_STEPS: String(MAX_STEPS) };
+// Same, with the trace gzipped by the program itself
+const RUN_ENV_GZIP = { ...RUN_ENV, LOG_COMPRESS: 'gzip' };
+// /run: the summary comes after the trace (see splitSummary()), so that
+// gzipped or not, the body is the same plain array of steps
+const RUN_ENV_SPLIT = { ...RUN_ENV, LOG_SUMMARY: 'trailer' };
+const RUN_ENV_SPLIT_GZIP = { ...RUN_ENV_GZIP, LOG_SUMMARY: 'trailer' };
+
+app.use(cors({ exposedHeaders: ['X-Trace-Steps', 'X-Trace-Steps-Dropped', 'X-Trace-Ops', 'Server-Timing', 'X-Trace-Cache', 'Retry-After'] }));
 app.use(express.json({ limit: '10mb' }));
 
 // Path to the build directory where C executables are located
 const BUILD_DIR = path.join(__dirname, 'build');
 
+// Algorithms and their input schemas, from the programs' --describe output
+const registry = new Registry(BUILD_DIR).load();
+
+// /run requests go to build/runner processes, which have every algorithm
+// linked in and run them on worker threads, instead of starting a program
+// per request. Without a runner binary each request starts its program.
+const RUNNER_PATH = path.join(BUILD_DIR, 'runner');
+const RUNNER_POOL_SIZE = 2;
+const runnerStat = fs.statSync(RUNNER_PATH, { throwIfNoEntry: false });
+const runnerPool = runnerStat
+    ? new RunnerPool(RUNNER_PATH, {
+        size: RUNNER_POOL_SIZE,
+        threads: Math.max(1, Math.ceil(os.cpus().length / RUNNER_POOL_SIZE))
+    })
+    : null;
+
+// Every program run, on the runner or as its own process, takes one of
+// RUN_SLOTS execution slots (one per core unless set in the environment);
+// runs beyond that queue, cheapest first, or are turned away with 429/503
+// and Retry-After (see scheduler.js). Cache hits and stored pages need no
+// slot.
+const RUN_SLOTS = Number(process.env.RUN_SLOTS) || os.cpus().length;
+const RUN_QUEUE = 64; // runs waiting for a slot
+const RUN_QUEUE_WAIT = 10000; // ms a run may wait for a slot
+const scheduler = new Scheduler({ slots: RUN_SLOTS, maxQueue: RUN_QUEUE, maxWait: RUN_QUEUE_WAIT });
+
+// GET /metrics, in the Prometheus text format (see metrics.js). Phase times
+// are by algorithm: queue_wait (for an execution slot), spawn (until the
+// process exists), run (until it exits, or the runner answers), parse (of
+// the trace's JSON, when the server parses it) and response (until the
+// response is handed to the OS).
+const metrics = new Metrics();
+const requestsTotal = metrics.counter('algoviz_requests_total',
+    'Requests for an algorithm, cache hits included', ['algorithm']);
+const errorsTotal = metrics.counter('algoviz_errors_total',
+    'Requests failed or turned away, by HTTP status', ['algorithm', 'status']);
+const timeoutsTotal = metrics.counter('algoviz_timeouts_total',
+    'Runs stopped at the execution timeout', ['algorithm']);
+const phaseSeconds = metrics.histogram('algoviz_phase_seconds',
+    'Time spent in each phase of a request', ['algorithm', 'phase'], { min: 1e-5, max: 60, perOctave: 2 });
+const stdoutBytes = metrics.histogram('algoviz_stdout_bytes',
+    'Size of the trace a run wrote', ['algorithm'], { min: 64, max: 256 * 1024 * 1024, perOctave: 1 });
+metrics.gauge('algoviz_executions_in_flight', 'Runs holding an execution slot', () => scheduler.running);
+metrics.gauge('algoviz_executions_queued', 'Runs waiting for an execution slot', () => scheduler.queue.length);
+metrics.gauge('algoviz_execution_slots', 'Execution slots (RUN_SLOTS)', () => scheduler.slots);
+
+function observePhase(algorithm, phase, ms) {
+    phaseSeconds.observe({ algorithm: algorithm.name, phase }, ms / 1000);
+}
+
+function countError(algorithm, status) {
+    errorsTotal.inc({ algorithm: algorithm.name, status: String(status) });
+    if (status === TIMEOUT_ERROR.status) timeoutsTotal.inc({ algorithm: algorithm.name });
+}
+
+// Waits for an execution slot for a run (see Scheduler.acquire()) and
+// resolves with the function that releases it
+async function admit(algorithm, inputs, signal) {
+    const start = performance.now();
+    try {
+        const release = await scheduler.acquire(registry.estimateCost(algorithm, inputs), signal);
+        observePhase(algorithm, 'queue_wait', performance.now() - start);
+        return release;
+    } catch (err) {
+        if (!signal?.aborted) countError(algorithm, err.status);
+        throw err;
+    }
+}
+
+// Times a started program: spawn until the process exists, run until it
+// exits
+function observeProcess(algorithm, child) {
+    const start = performance.now();
+    let spawned = start;
+    child.once('spawn', () => {
+        spawned = performance.now();
+        observePhase(algorithm, 'spawn', spawned - start);
+    });
+    child.once('exit', () => observePhase(algorithm, 'run', performance.now() - spawned));
+}
+
+// Times the response from now until it is written out
+function observeResponse(res, algorithm) {
+    const start = performance.now();
+    res.once('finish', () => observePhase(algorithm, 'response', performance.now() - start));
+}
+
+// Finished traces are cached (see trace_cache.js), keyed by the algorithm,
+// the arguments the program receives, the LOG_* settings and the size and
+// mtime of the code that runs it (the runner's, or the program's), so a
+// rebuild invalidates them. Programs that describe themselves as
+// nondeterministic are never cached, nor are timed runs.
+const TRACE_CACHE_DIR = path.join(BUILD_DIR, 'trace-cache');
+const traceCache = new TraceCache({
+    dir: TRACE_CACHE_DIR,
+    memoryBytes: 64 * 1024 * 1024,
+    diskBytes: 512 * 1024 * 1024
+});
+const runnerVersion = runnerStat ? `runner:${runnerStat.size}:${runnerStat.mtimeMs}` : null;
+// Cache misses being run, so identical concurrent requests run once
+const runsInFlight = new Map();
+
+// Traces stored for ranged reads (see trace_store.js and /trace below).
+// They get a much larger step budget than /run: the client only ever holds
+// the pages around the playhead.
+const traceStore = new TraceStore({ dir: path.join(BUILD_DIR, 'trace-store'), maxBytes: 1024 * 1024 * 1024 });
+const STORE_MAX_STEPS = 100000; // LOG_MAX_STEPS of stored traces
+const STORE_MAX_TRACE = 256 * 1024 * 1024; // bytes
+const PAGE_STEPS = 200; // steps per page unless asked otherwise
+const MAX_PAGE_STEPS = 1000;
+// Traces being generated, by id
+const storesInFlight = new Map();
+
+// The logger writes a summary when a step budget is set or the algorithm
+// counts its operations. For /run it comes after the trace (LOG_SUMMARY=
+// trailer): the summary object, its length as a little-endian u32 and
+// "TSUM", uncompressed even when the trace is gzipped. Returns the trace and
+// the parsed summary (null when there is none).
+function splitSummary(stdout) {
+    const end = stdout.length - 8;
+    if (end < 0 || stdout.toString('latin1', end + 4) !== 'TSUM') return { trace: stdout, summary: null };
+    const start = end - stdout.readUInt32LE(end);
+    return { trace: stdout.subarray(0, start), summary: JSON.parse(stdout.toString('utf8', start, end)) };
+}
+
+// Reports a run's summary in headers, so the body stays a plain array of
+// steps:
+//   X-Trace-Steps, X-Trace-Steps-Dropped   steps logged and thinned out
+//   X-Trace-Ops   comparisons=N, swaps=N, reads=N, writes=N
+//   Server-Timing algorithm;dur=MS, logger;dur=MS   when the server runs
+//                 with LOG_TIMING=1 (time in the algorithm vs. writing the
+//                 trace)
+function setSummaryHeaders(res, summary) {
+    if (summary.steps !== undefined) {
+        res.set('X-Trace-Steps', String(summary.steps));
+        res.set('X-Trace-Steps-Dropped', String(summary.steps_dropped));
+    }
+    if (summary.comparisons !== undefined) {
+        res.set('X-Trace-Ops', ['comparisons', 'swaps', 'reads', 'writes']
+            .map(name => `${name}=${summary[name]}`).join(', '));
+    }
+    if (summary.algorithm_ns !== undefined) {
+        res.set('Server-Timing', `algorithm;dur=${summary.algorithm_ns / 1e6}, logger;dur=${summary.logger_ns / 1e6}`);
+    }
+}
+
+// True when the client takes gzip responses (Accept-Encoding lists gzip or *
+// without q=0). Such clients get the program's gzipped trace byte for byte,
+// without it ever being inflated here.
+function acceptsGzip(req) {
+    const header = req.headers['accept-encoding'] || '';
+    return header.split(',').some(part => {
+        const [coding, ...params] = part.trim().split(';');
+        if (coding.trim() !== 'gzip' && coding.trim() !== '*') return false;
+        return !params.some(param => /^\s*q=0(\.0*)?\s*$/.test(param));
+    });
+}
+
+// Headers of a trace sent as the program wrote it (gzipped or not)
+function setRawTraceHeaders(res, gzip) {
+    res.set({ 'Content-Type': 'application/json; charset=utf-8', 'Vary': 'Accept-Encoding' });
+    if (gzip) res.set('Content-Encoding', 'gzip');
+}
+
+// Sends a { status, body } error; admission rejections carry Retry-After
+function sendError(res, err) {
+    if (err.retryAfter) res.set('Retry-After', String(err.retryAfter));
+    res.status(err.status || 500).json(err.body || { error: err.message });
+}
+
+function sendCompressedTrace(res, trace) {
+    setRawTraceHeaders(res, true);
+    res.end(trace);
+}
+
 // Input validation helper
 function validateInputs(inputs) {
     if (!Array.isArray(inputs)) {
@@ -42,98 +246,662 @@ function validateInputs(inputs) {
     return { valid: true };
 }
 
+// Looks up the algorithm of a request in the registry and checks the
+// arguments (sanitized: only these characters ever reach a program) against
+// its inputs. Returns { algorithm, args }, or { status, body } for the error
+// response.
+function lookupRequest(name, inputs) {
+    const algorithm = registry.get(name);
+    if (!algorithm) {
+        return { status: 404, body: { error: `Algorithm '${name}' not found or not compiled.` } };
+    }
+    requestsTotal.inc({ algorithm: name });
+    const args = inputs.map(arg => String(arg).replace(/[^a-zA-Z0-9\-\s,()[\]{}]/g, ''));
+    const error = registry.validate(algorithm, args);
+    if (error) {
+        countError(algorithm, 400);
+        return { status: 400, body: { error } };
+    }
+    return { algorithm, args };
+}
+
+// lookupRequest(), sending the error response and returning null on error
+function resolveRequest(res, name, inputs) {
+    const request = lookupRequest(name, inputs);
+    if (request.algorithm) return request;
+    res.status(request.status).json(request.body);
+    return null;
+}
+
 app.post('/run/:algorithm', (req, res) => {
-    const algorithm = req.params.algorithm;
     const inputs = req.body.inputs || [];
 
-    // Sanitize input to prevent command injection (alphanumeric and hyphens only)
-    if (!/^[a-z0-9_-]+$/i.test(algorithm)) {
-        return res.status(400).json({ error: "Invalid algorithm name" });
-    }
-
     // Validate inputs
     const validation = validateInputs(inputs);
     if (!validation.valid) {
         return res.status(400).json({ error: validation.error });
     }
 
-    const executablePath = path.join(BUILD_DIR, algorithm);
+    const request = resolveRequest(res, req.params.algorithm, inputs);
+    if (!request) return;
+    const send = req.query.stream ? streamAndSend : runAndSend;
+    send(req, res, request.algorithm, request.args, { timeout: EXECUTION_TIMEOUT });
+});
+
+// Original GET handler for backwards compatibility or simple runs
+app.get('/run/:algorithm', (req, res) => {
+    const request = resolveRequest(res, req.params.algorithm, []);
+    if (!request) return;
 
-    // Check if executable exists
-    if (!fs.existsSync(executablePath)) {
-        return res.status(404).json({ error: `Algorithm '${algorithm}' not found or not compiled.` });
+    // Runner threads cannot be abandoned, so runner requests always get the
+    // timeout; programs started per request keep running without one here.
+    if (req.query.stream) {
+        return streamAndSend(req, res, request.algorithm, [], { timeout: 0 });
     }
+    runAndSend(req, res, request.algorithm, [], { timeout: runnerPool ? EXECUTION_TIMEOUT : 0 });
+});
 
-    // Construct command with arguments
-    // Ensure inputs are safe: basic sanitization (only numbers for now for Two Sum)
-    // In a production app, robust sanitization is needed.
-    const safeInputs = inputs.map(arg => String(arg).replace(/[^a-zA-Z0-9\-\s,()[\]{}]/g, ''));
-    const args = safeInputs.map(arg => `"${arg}"`).join(' ');
+const MAX_BATCH_JOBS = 256;
 
-    // Execute the C program with timeout
-    const child = exec(`${executablePath} ${args}`, {
-        timeout: EXECUTION_TIMEOUT,
-        maxBuffer: 1024 * 1024 // 1MB buffer
-    }, (error, stdout, stderr) => {
-        if (error) {
-            if (error.killed) {
-                return res.status(408).json({ 
-                    error: "Execution timeout",
-                    details: `Algorithm took longer than ${EXECUTION_TIMEOUT / 1000} seconds.`
+// One job of a batch; resolves with its result as JSON text:
+//   {"index": I, "algorithm": ..., "status": 200, "cache": ..., "trace": [...]}
+// on one line, or, when it fails, the status with the error and details of
+// the response /run would have sent. The trace is the program's output as
+// written (summary element included), not re-serialized.
+async function runBatchJob(index, job) {
+    const name = job && typeof job.algorithm === 'string' ? job.algorithm : '';
+    const failure = (status, body) => JSON.stringify({ index, algorithm: name, status, ...body });
+    const inputs = (job && job.inputs) || [];
+    const validation = validateInputs(inputs);
+    if (!validation.valid) return failure(400, { error: validation.error });
+    const request = lookupRequest(name, inputs);
+    if (!request.algorithm) return failure(request.status, request.body);
+    try {
+        const { stdout, cache } = await cachedRun(request.algorithm, request.args, RUN_ENV, EXECUTION_TIMEOUT);
+        // Newlines only occur between JSON tokens: dropping them keeps the
+        // result on one line
+        const trace = stdout.toString().replace(/\n/g, '');
+        return `{"index": ${index}, "algorithm": ${JSON.stringify(name)}, "status": 200, "cache": "${cache}", "trace": ${trace}}`;
+    } catch (err) {
+        return failure(err.status || 500, err.body || { error: err.message });
+    }
+}
+
+// Many runs in one request, for preparing traces in bulk:
+//   POST /run-batch  {"jobs": [{"algorithm": "bubble_sort", "inputs": [...]}, ...]}
+// RUN_SLOTS workers take the jobs in turn, so a batch keeps every execution
+// slot busy without flooding the scheduler's queue. The response is the
+// array of results in job order (see runBatchJob()); with ?stream=1 it is
+// NDJSON instead, one result per line as each job finishes. Jobs fail
+// independently: a batch answers 200 with each job's own status.
+app.post('/run-batch', async (req, res) => {
+    const jobs = req.body.jobs;
+    if (!Array.isArray(jobs) || jobs.length === 0) {
+        return res.status(400).json({ error: 'jobs must be a non-empty array of {algorithm, inputs}.' });
+    }
+    if (jobs.length > MAX_BATCH_JOBS) {
+        return res.status(400).json({ error: `Too many jobs. Maximum ${MAX_BATCH_JOBS} per batch.` });
+    }
+
+    const stream = Boolean(req.query.stream);
+    const results = new Array(jobs.length);
+    let closed = false;
+    res.on('close', () => { closed = true; });
+    if (stream) res.set('Content-Type', 'application/x-ndjson; charset=utf-8');
+
+    let next = 0;
+    const worker = async () => {
+        while (next < jobs.length && !closed) {
+            const index = next++;
+            const result = await runBatchJob(index, jobs[index]);
+            if (!stream) {
+                results[index] = result;
+            } else if (!closed && !res.write(result + '\n')) {
+                await new Promise(resolve => {
+                    res.once('drain', resolve);
+                    res.once('close', resolve);
                 });
             }
-            console.error(`Error executing ${algorithm}:`, error);
-            console.error(`Stderr:`, stderr);
-            return res.status(500).json({ error: "Execution failed", details: stderr });
         }
+    };
+    await Promise.all(Array.from({ length: Math.min(RUN_SLOTS, jobs.length) }, worker));
+
+    if (closed) return;
+    if (stream) return res.end();
+    res.set('Content-Type', 'application/json; charset=utf-8');
+    res.send(`[${results.join(',')}]`);
+});
+
+const TIMEOUT_ERROR = {
+    status: 408,
+    body: { error: "Execution timeout", details: `Algorithm took longer than ${EXECUTION_TIMEOUT / 1000} seconds.` }
+};
+const TOO_LARGE_ERROR = {
+    status: 500,
+    body: { error: "Execution failed", details: `Trace larger than ${MAX_OUTPUT} bytes; request it with ?stream=1` }
+};
+
+// Runs a program (a registry entry) on the runner pool, or starts it when
+// there is no runner, once the scheduler gives it a slot. Resolves with its
+// stdout as a Buffer; rejects with { status, body } for the HTTP error
+// response.
+async function runAlgorithm(algorithm, inputs, env, timeout) {
+    const release = await admit(algorithm, inputs);
+    try {
+        return await execute(algorithm, inputs, env, timeout);
+    } catch (err) {
+        countError(algorithm, err.status);
+        throw err;
+    } finally {
+        release();
+    }
+}
+
+function execute(algorithm, inputs, env, timeout) {
+    if (runnerPool) {
+        const start = performance.now();
+        return runnerPool.run(algorithm.name, inputs, env, { timeout, maxOutput: MAX_OUTPUT }).then(
+            ({ status, stdout }) => {
+                observePhase(algorithm, 'run', performance.now() - start);
+                if (status !== 0) {
+                    console.error(`Error executing ${algorithm.name}: exit code ${status}`);
+                    throw { status: 500, body: { error: "Execution failed", details: `Exit code ${status}` } };
+                }
+                stdoutBytes.observe({ algorithm: algorithm.name }, stdout.length);
+                return stdout;
+            },
+            err => {
+                if (err.code === 'TIMEOUT') throw TIMEOUT_ERROR;
+                if (err.code === 'TOO_LARGE') throw TOO_LARGE_ERROR;
+                console.error(`Error executing ${algorithm.name}:`, err.message);
+                throw { status: 500, body: { error: "Execution failed", details: err.message } };
+            });
+    }
 
+    // Arguments go straight to the program (no shell)
+    return new Promise((resolve, reject) => {
+        const child = execFile(algorithm.file, [...algorithm.argv, ...inputs], {
+            timeout,
+            maxBuffer: MAX_OUTPUT,
+            env,
+            encoding: 'buffer'
+        }, (error, stdout, stderr) => {
+            stderr = String(stderr);
+            if (error) {
+                if (error.code === 'ERR_CHILD_PROCESS_STDIO_MAXBUFFER') return reject(TOO_LARGE_ERROR);
+                if (error.killed) return reject(TIMEOUT_ERROR);
+                console.error(`Error executing ${algorithm.name}:`, error);
+                console.error(`Stderr:`, stderr);
+                return reject({ status: 500, body: { error: "Execution failed", details: stderr } });
+            }
+            stdoutBytes.observe({ algorithm: algorithm.name }, stdout.length);
+            resolve(stdout);
+        });
+        observeProcess(algorithm, child);
+    });
+}
+
+const CACHED_OPTIONS = ['LOG_FORMAT', 'LOG_DELTA', 'LOG_KEYFRAME', 'LOG_MAX_STEPS', 'LOG_COMPRESS', 'LOG_SUMMARY'];
+
+// Cache key of a run of the code of the given version, or null when its
+// trace must not be cached. Inputs the program reads the same way share a
+// key (see Registry.canonicalArgs()).
+function cacheKey(algorithm, inputs, env, version) {
+    if (!algorithm.deterministic || env.LOG_TIMING) return null;
+    const options = CACHED_OPTIONS.map(name => env[name] ?? null);
+    return traceKey(algorithm.name, registry.canonicalArgs(algorithm, inputs), options, version);
+}
+
+// runAlgorithm() through the trace cache; resolves with { stdout, cache }
+// where cache is 'memory', 'disk', 'miss' or 'off'.
+async function cachedRun(algorithm, inputs, env, timeout) {
+    const key = cacheKey(algorithm, inputs, env, runnerVersion ?? algorithm.version);
+    if (key === null) {
+        return { stdout: await runAlgorithm(algorithm, inputs, env, timeout), cache: 'off' };
+    }
+
+    const hit = await traceCache.get(key);
+    if (hit) return { stdout: hit.data, cache: hit.tier };
+
+    let run = runsInFlight.get(key);
+    if (!run) {
+        run = runAlgorithm(algorithm, inputs, env, timeout)
+            .then(stdout => {
+                traceCache.put(key, stdout);
+                return stdout;
+            })
+            .finally(() => runsInFlight.delete(key));
+        runsInFlight.set(key, run);
+    }
+    return { stdout: await run, cache: 'miss' };
+}
+
+function runAndSend(req, res, algorithm, inputs, { timeout }) {
+    const gzip = acceptsGzip(req);
+    cachedRun(algorithm, inputs, gzip ? RUN_ENV_SPLIT_GZIP : RUN_ENV_SPLIT, timeout).then(({ stdout, cache }) => {
+        res.set('X-Trace-Cache', cache);
+        let text = '';
         try {
-            const steps = JSON.parse(stdout);
+            const parseStart = performance.now();
+            const { trace, summary } = splitSummary(stdout);
+            if (summary) setSummaryHeaders(res, summary);
+            if (gzip) {
+                observeResponse(res, algorithm);
+                return sendCompressedTrace(res, trace);
+            }
+
+            // The C program should output valid JSON to stdout
+            text = trace.toString();
+            const steps = JSON.parse(text);
+            observePhase(algorithm, 'parse', performance.now() - parseStart);
+            res.set('Vary', 'Accept-Encoding');
+            observeResponse(res, algorithm);
             res.json(steps);
         } catch (parseError) {
-            console.error("JSON Parse Error:", parseError, "Stdout:", stdout);
+            text = text || stdout.toString();
+            console.error("JSON Parse Error:", parseError, "Stdout:", text);
             res.status(500).json({
                 error: "Failed to parse algorithm output",
                 details: "Output was not valid JSON",
-                rawOutput: stdout
+                rawOutput: text
             });
         }
+    }, err => sendError(res, err));
+}
+
+// Traces up to this size are kept while streaming, for the trace cache
+const STREAM_CACHE_LIMIT = 1024 * 1024;
+
+// /run?stream=1: starts the program and pipes its stdout into the response
+// as it is written, never holding the trace here. Backpressure goes all the
+// way back: while the client is slow to read, the program blocks in
+// write(). The programs come from the registry and are trusted, so their
+// output is neither parsed nor size-limited; like a gzipped trace, the body
+// keeps its {"summary": ...} element. Small traces still go into the trace
+// cache and are answered from it.
+async function streamAndSend(req, res, algorithm, inputs, { timeout }) {
+    const gzip = acceptsGzip(req);
+    const env = gzip ? RUN_ENV_GZIP : RUN_ENV;
+    const key = cacheKey(algorithm, inputs, env, algorithm.version);
+    const hit = key && await traceCache.get(key);
+    if (hit) {
+        setRawTraceHeaders(res, gzip);
+        res.set('X-Trace-Cache', hit.tier);
+        observeResponse(res, algorithm);
+        return res.end(hit.data);
+    }
+
+    // Leaving while queued gives up the place in the queue
+    const cancel = new AbortController();
+    res.on('close', () => cancel.abort());
+    let release;
+    try {
+        release = await admit(algorithm, inputs, cancel.signal);
+    } catch (err) {
+        if (!cancel.signal.aborted) sendError(res, err);
+        return;
+    }
+
+    const child = spawn(algorithm.file, [...algorithm.argv, ...inputs], { env, stdio: ['ignore', 'pipe', 'pipe'] });
+    child.on('close', release);
+    child.on('error', release);
+    observeProcess(algorithm, child);
+    let started = false;
+    let bytes = 0;
+    let finished = false;
+    let timedOut = false;
+    let stderr = '';
+    let kept = key ? [] : null; // the trace so far, while it is small
+    let keptSize = 0;
+
+    const timer = timeout > 0 && setTimeout(() => {
+        timedOut = true;
+        child.kill('SIGKILL');
+    }, timeout);
+
+    // Before the first byte the client gets a proper error; after it, all
+    // that can be done is to cut the response short.
+    const fail = (error) => {
+        finished = true;
+        clearTimeout(timer);
+        countError(algorithm, error.status);
+        if (started) return res.destroy();
+        res.status(error.status).json(error.body);
+    };
+
+    child.stdout.on('data', chunk => {
+        if (!started) {
+            started = true;
+            setRawTraceHeaders(res, gzip);
+            res.set('X-Trace-Cache', key ? 'miss' : 'off');
+        }
+        bytes += chunk.length;
+        if (kept) {
+            keptSize += chunk.length;
+            if (keptSize <= STREAM_CACHE_LIMIT) kept.push(chunk);
+            else kept = null;
+        }
+        if (!res.write(chunk)) {
+            child.stdout.pause();
+            res.once('drain', () => child.stdout.resume());
+        }
+    });
+    child.stderr.on('data', chunk => {
+        if (stderr.length < 64 * 1024) stderr += chunk;
+    });
+
+    child.on('error', err => {
+        console.error(`Error executing ${algorithm.name}:`, err);
+        if (!finished) fail({ status: 500, body: { error: "Execution failed", details: err.message } });
+    });
+    child.on('close', code => {
+        if (finished) return;
+        if (timedOut) return fail(TIMEOUT_ERROR);
+        if (code !== 0) {
+            console.error(`Error executing ${algorithm.name}: exit code ${code}`);
+            console.error(`Stderr:`, stderr);
+            return fail({ status: 500, body: { error: "Execution failed", details: stderr } });
+        }
+        finished = true;
+        clearTimeout(timer);
+        stdoutBytes.observe({ algorithm: algorithm.name }, bytes);
+        if (!started) setRawTraceHeaders(res, gzip);
+        // What the client has yet to read when the program is done
+        observeResponse(res, algorithm);
+        res.end();
+        if (kept) traceCache.put(key, Buffer.concat(kept, keptSize));
+    });
+
+    // Client went away: stop the program
+    res.on('close', () => {
+        if (!finished) {
+            finished = true;
+            clearTimeout(timer);
+            child.kill('SIGKILL');
+        }
     });
+}
+
+// What each algorithm accepts (input schema, size limits, cost class)
+app.get('/algorithms', (req, res) => {
+    res.json(registry.describeAll());
 });
 
-// Original GET handler for backwards compatibility or simple runs
-app.get('/run/:algorithm', (req, res) => {
-    const algorithm = req.params.algorithm;
-    if (!/^[a-z0-9_-]+$/i.test(algorithm)) {
-        return res.status(400).json({ error: "Invalid algorithm name" });
+// Trace cache counters, for sizing the cache
+app.get('/cache/stats', (req, res) => {
+    res.json(traceCache.stats());
+});
+
+app.get('/metrics', (req, res) => {
+    res.set('Content-Type', 'text/plain; version=0.0.4; charset=utf-8');
+    res.send(metrics.render());
+});
+
+// Execution slots in use, queue depth, admissions and rejections, and the
+// recent queue wait percentiles
+app.get('/scheduler/stats', (req, res) => {
+    res.json(scheduler.stats());
+});
+
+// Runs a program into the trace store; resolves with the trace's id.
+// Deterministic traces are stored under their cache key, so asking again
+// for the same run finds the stored trace instead of running it again.
+// Stored traces are delta-encoded (LOG_DELTA=1): each tree node is written
+// once instead of with every step after it, which is what makes large
+// recursion trees fit.
+function storeTrace(algorithm, inputs) {
+    const env = { ...RUN_ENV, LOG_FORMAT: 'ndjson', LOG_DELTA: '1', LOG_MAX_STEPS: String(STORE_MAX_STEPS) };
+    const id = cacheKey(algorithm, inputs, env, algorithm.version) ?? crypto.randomBytes(16).toString('hex');
+    if (traceStore.has(id)) return Promise.resolve(id);
+    if (storesInFlight.has(id)) return storesInFlight.get(id);
+
+    const run = admit(algorithm, inputs).then(release => new Promise((resolve, reject) => {
+        const child = spawn(algorithm.file, [...algorithm.argv, ...inputs], { env, stdio: ['ignore', 'pipe', 'pipe'] });
+        observeProcess(algorithm, child);
+        const trace = traceStore.create(id);
+        let stderr = '';
+        let failure = null;
+        let settled = false;
+
+        const timer = setTimeout(() => {
+            failure = TIMEOUT_ERROR;
+            child.kill('SIGKILL');
+        }, EXECUTION_TIMEOUT);
+
+        child.stdout.on('data', chunk => {
+            if (failure) return;
+            if (trace.size() + chunk.length > STORE_MAX_TRACE) {
+                failure = { status: 500, body: { error: "Execution failed", details: "Trace too large" } };
+                child.kill('SIGKILL');
+                return;
+            }
+            if (!trace.write(chunk)) {
+                child.stdout.pause();
+                trace.onDrain(() => child.stdout.resume());
+            }
+        });
+        child.stderr.on('data', chunk => {
+            if (stderr.length < 64 * 1024) stderr += chunk;
+        });
+
+        const settle = (code, error) => {
+            if (settled) return;
+            settled = true;
+            clearTimeout(timer);
+            if (!failure && error) failure = { status: 500, body: { error: "Execution failed", details: error.message } };
+            if (!failure && code !== 0) {
+                console.error(`Error executing ${algorithm.name}: exit code ${code}`);
+                console.error(`Stderr:`, stderr);
+                failure = { status: 500, body: { error: "Execution failed", details: stderr } };
+            }
+            if (failure) {
+                countError(algorithm, failure.status);
+                trace.abort();
+                return reject(failure);
+            }
+            stdoutBytes.observe({ algorithm: algorithm.name }, trace.size());
+            trace.commit().then(() => resolve(id), err => {
+                console.error('Trace store write failed:', err.message);
+                reject({ status: 500, body: { error: "Execution failed", details: err.message } });
+            });
+        };
+        child.on('error', err => settle(null, err));
+        child.on('close', code => settle(code, null));
+    }).finally(release)).finally(() => storesInFlight.delete(id));
+    storesInFlight.set(id, run);
+    return run;
+}
+
+// from/count query parameters of a page request, or null when invalid
+function pageRange(query) {
+    const from = query.from === undefined ? 0 : Number(query.from);
+    const count = query.count === undefined ? PAGE_STEPS : Number(query.count);
+    if (!Number.isInteger(from) || from < 0) return null;
+    if (!Number.isInteger(count) || count < 1 || count > MAX_PAGE_STEPS) return null;
+    return { from, count };
+}
+
+// Sends a page of a stored trace:
+//   {"id": ..., "total": N, "from": F, "steps": [...], "summary": {...}}
+// steps holds steps [F, F + count) (fewer at the end); total is the number
+// of steps in the whole trace. The steps are copied out of the stored trace
+// as text, without being parsed, so they are delta-encoded: a client
+// replays them from step 0 in order (frontend/src/traceReplay.js). summary
+// is only sent with the first page.
+async function sendPage(res, id, { from, count }, withSummary) {
+    const page = await traceStore.read(id, from, count, { summary: withSummary });
+    if (!page) return res.status(404).json({ error: `Trace '${id}' not found (it may have expired).` });
+    const summary = page.summary ? `, "summary": ${JSON.stringify(JSON.parse(page.summary).summary)}` : '';
+    res.set('Content-Type', 'application/json; charset=utf-8');
+    res.send(`{"id": "${id}", "total": ${page.total}, "from": ${from}, "steps": [${page.steps}]${summary}}`);
+}
+
+// Stored traces, for playing long traces without downloading them first.
+// POST /trace/:algorithm with {"inputs": [...], "count": N} runs the
+// algorithm into the trace store and answers with the trace's first page;
+// GET /trace/:id?from=F&count=N fetches any other page (count is at most
+// MAX_PAGE_STEPS).
+app.post('/trace/:algorithm', (req, res) => {
+    const inputs = req.body.inputs || [];
+    const validation = validateInputs(inputs);
+    if (!validation.valid) {
+        return res.status(400).json({ error: validation.error });
     }
+    const range = pageRange({ count: req.body.count });
+    if (!range) {
+        return res.status(400).json({ error: `count must be an integer from 1 to ${MAX_PAGE_STEPS}.` });
+    }
+    const request = resolveRequest(res, req.params.algorithm, inputs);
+    if (!request) return;
 
+    storeTrace(request.algorithm, request.args)
+        .then(id => sendPage(res, id, range, true))
+        .catch(err => sendError(res, err));
+});
 
-    const executablePath = path.join(BUILD_DIR, algorithm);
+app.get('/trace/:id', (req, res) => {
+    const id = req.params.id;
+    if (!/^[0-9a-f]+$/.test(id)) {
+        return res.status(404).json({ error: `Trace '${id}' not found (it may have expired).` });
+    }
+    const range = pageRange(req.query);
+    if (!range) {
+        return res.status(400).json({
+            error: `from must be a non-negative integer and count an integer from 1 to ${MAX_PAGE_STEPS}.`
+        });
+    }
+    sendPage(res, id, range, false).catch(err => res.status(500).json({ error: err.message }));
+});
+
+// Streaming variant of /run for long traces: the program writes NDJSON
+// (LOG_FORMAT=ndjson) and every step is forwarded as a Server-Sent Event as
+// soon as its line arrives, so the first steps show up while the algorithm
+// is still running; like /run?stream=1, a client that reads slowly holds
+// the program back. EventSource only issues GET requests, so inputs are
+// passed as repeated query parameters: /stream/bubble_sort?inputs=5,3,8
+//
+// Events: `data` carries one step; `summary` the trace summary (when steps
+// were budgeted); `end` marks a complete run; `error` a failed one.
+app.get('/stream/:algorithm', async (req, res) => {
+    let inputs = req.query.inputs || [];
+    if (!Array.isArray(inputs)) inputs = [inputs];
+    if (inputs.length > 0) {
+        const validation = validateInputs(inputs);
+        if (!validation.valid) {
+            return res.status(400).json({ error: validation.error });
+        }
+    }
+
+    const request = resolveRequest(res, req.params.algorithm, inputs);
+    if (!request) return;
+    const algorithm = request.algorithm.name;
 
-    // Check if executable exists
-    if (!fs.existsSync(executablePath)) {
-        return res.status(404).json({ error: `Algorithm '${algorithm}' not found or not compiled.` });
+    // Queued before the event stream starts, so a rejection is a plain
+    // 429/503 response
+    const cancel = new AbortController();
+    res.on('close', () => cancel.abort());
+    let release;
+    try {
+        release = await admit(request.algorithm, request.args, cancel.signal);
+    } catch (err) {
+        if (!cancel.signal.aborted) sendError(res, err);
+        return;
     }
 
-    // Execute the C program
-    exec(executablePath, (error, stdout, stderr) => {
+    // Arguments go straight to the program (no shell)
+    const child = spawn(request.algorithm.file, [...request.algorithm.argv, ...request.args], {
+        env: { ...RUN_ENV, LOG_FORMAT: 'ndjson' }
+    });
+    child.on('close', release);
+    child.on('error', release);
+    observeProcess(request.algorithm, child);
+
+    res.writeHead(200, {
+        'Content-Type': 'text/event-stream',
+        'Cache-Control': 'no-cache',
+        'Connection': 'keep-alive'
+    });
+
+    // Returns false when the response is buffering (see 'drain')
+    const sendEvent = (event, data) => {
+        return res.write(event ? `event: ${event}\ndata: ${data}\n\n` : `data: ${data}\n\n`);
+    };
+
+    let pending = '';
+    let bytes = 0;
+    let stderr = '';
+    let timedOut = false;
+    let finished = false;
+
+    child.stdout.setEncoding('utf8');
+    child.stdout.on('data', chunk => {
+        bytes += Buffer.byteLength(chunk);
+        pending += chunk;
+        let start = 0;
+        let newline;
+        let flowing = true;
+        while ((newline = pending.indexOf('\n', start)) >= 0) {
+            const line = pending.slice(start, newline);
+            start = newline + 1;
+            if (line.length === 0) continue;
+            if (!sendEvent(line.startsWith('{"summary"') ? 'summary' : null, line)) flowing = false;
+        }
+        pending = pending.slice(start);
+        if (!flowing) {
+            child.stdout.pause();
+            res.once('drain', () => child.stdout.resume());
+        }
+    });
+    child.stderr.on('data', chunk => {
+        if (stderr.length < 64 * 1024) stderr += chunk;
+    });
+
+    const timer = setTimeout(() => {
+        timedOut = true;
+        child.kill('SIGKILL');
+    }, EXECUTION_TIMEOUT);
+
+    const finish = (error) => {
+        if (finished) return;
+        finished = true;
+        clearTimeout(timer);
         if (error) {
-            console.error(`Error executing ${algorithm}:`, error);
-            return res.status(500).json({ error: "Execution failed", details: stderr });
+            sendEvent('error', JSON.stringify(error));
+        } else {
+            sendEvent('end', '{}');
         }
+        res.end();
+    };
 
-        try {
-            // The C program should output valid JSON to stdout
-            const steps = JSON.parse(stdout);
-            res.json(steps);
-        } catch (parseError) {
-            console.error("JSON Parse Error:", parseError, "Stdout:", stdout);
-            res.status(500).json({
-                error: "Failed to parse algorithm output",
-                details: "Output was not valid JSON",
-                rawOutput: stdout
+    child.on('error', err => {
+        console.error(`Error executing ${algorithm}:`, err);
+        countError(request.algorithm, 500);
+        finish({ error: "Execution failed", details: err.message });
+    });
+    child.on('close', code => {
+        if (timedOut) {
+            countError(request.algorithm, TIMEOUT_ERROR.status);
+            finish({
+                error: "Execution timeout",
+                details: `Algorithm took longer than ${EXECUTION_TIMEOUT / 1000} seconds.`
             });
+        } else if (code !== 0) {
+            console.error(`Error executing ${algorithm}: exit code ${code}`);
+            console.error(`Stderr:`, stderr);
+            countError(request.algorithm, 500);
+            finish({ error: "Execution failed", details: stderr });
+        } else {
+            stdoutBytes.observe({ algorithm }, bytes);
+            finish(null);
+        }
+    });
+
+    // Browser went away: stop the program instead of running it to the end
+    res.on('close', () => {
+        if (!finished) {
+            finished = true;
+            clearTimeout(timer);
+            child.kill('SIGKILL');
         }
     });
 });
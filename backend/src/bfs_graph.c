@@ -20,8 +20,8 @@ int graph[NODES][NODES] = {
 };
 
 // Queue Implementation
-int queue[100];
-int front = -1, rear = -1;
+_Thread_local int queue[100];
+_Thread_local int front = -1, rear = -1;
 
 void enqueue(int val) {
     if (front == -1) front = 0;
@@ -37,7 +37,20 @@ int isEmpty() {
     return front == -1 || front > rear;
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "start", .type = LOG_INPUT_INT, .min = 0, .max = NODES - 1},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LINEAR,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(bfs_graph) {
+    if (log_describe(argc, argv, &description)) return 0;
+    // Empty queue (main() may run more than once, see tools/runner.c)
+    front = rear = -1;
     log_init();
     
     int start_node = 0;
@@ -97,6 +110,7 @@ int main(int argc, char* argv[]) {
     log_message("BFS Traversal Complete.");
     log_step_end();
 
+    log_result(visited, NODES);
     log_finish();
     return 0;
 }
@@ -6,7 +6,19 @@
 // Input: Sorted Array, Target
 // Visualization: Highlights Left, Right, Mid pointers.
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "target", .type = LOG_INPUT_INT},
+    {.name = "nums", .type = LOG_INPUT_INT_ARGS, .max_size = 100},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LOGARITHMIC,
+    .inputs = inputs,
+    .input_count = 2,
+};
+
+int ALGORITHM_MAIN(binary_search) {
+    if (log_describe(argc, argv, &description)) return 0;
     log_init();
 
     int nums[100];
@@ -58,6 +70,7 @@ int main(int argc, char* argv[]) {
             log_highlight("Found", mid); // Using 'Found' as a highlight label
             log_message("Target Found!");
             log_step_end();
+            log_result(&mid, 1);
             log_finish();
             return 0;
         }
@@ -13,8 +13,8 @@ typedef struct {
     int right_idx;
 } TreeNode;
 
-TreeNode tree[MAX_NODES];
-int tree_size = 0;
+_Thread_local TreeNode tree[MAX_NODES];
+_Thread_local int tree_size = 0;
 
 typedef struct {
     int items[MAX_NODES];
@@ -112,7 +112,20 @@ void build_tree(char** args, int count) {
     }
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "nodes", .type = LOG_INPUT_TREE, .max_size = MAX_NODES},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LINEAR,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(binary_tree_level_order) {
+    if (log_describe(argc, argv, &description)) return 0;
+    // The tree is rebuilt from argv on every run
+    tree_size = 0;
     log_init();
 
     // Parse Args
@@ -231,7 +244,7 @@ int main(int argc, char* argv[]) {
         }
         
         // Log after processing children
-        int new_q_len = (bfs_q.rear - bfs_q.front + 1);
+        int new_q_len = isEmpty(&bfs_q) ? 0 : (bfs_q.rear - bfs_q.front + 1);
         int new_q_snapshot[MAX_NODES];
         for(int i=0; i<new_q_len; i++) {
             int node_idx = bfs_q.items[bfs_q.front + i];
@@ -252,6 +265,7 @@ int main(int argc, char* argv[]) {
     log_message("Traversal Complete!");
     log_step_end();
 
+    log_result(result_list, result_count);
     log_finish();
     return 0;
 }
@@ -16,7 +16,18 @@
 
 // Search for target.
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "target", .type = LOG_INPUT_INT},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LOGARITHMIC,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(bst_search) {
+    if (log_describe(argc, argv, &description)) return 0;
     log_init();
 
     int target = 5;
@@ -86,6 +97,7 @@ int main(int argc, char* argv[]) {
         log_step_end();
     }
 
+    log_result(&found, 1);
     log_finish();
     return 0;
 }
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "../include/logger.h"
 
 // Bubble Sort
@@ -10,12 +11,58 @@ void swap(int* a, int* b) {
     int temp = *a;
     *a = *b;
     *b = temp;
+    log_count_swap(1);
+    log_count_read(2);
+    log_count_write(2);
 }
 
-int main(int argc, char* argv[]) {
+void bubbleSort(int nums[], int n) {
+    for (int i = 0; i < n - 1; i++) {
+        for (int j = 0; j < n - i - 1; j++) {
+            
+            // Highlight comparison
+            log_step_start();
+            log_highlight("Sort Array", j);
+            log_highlight("Sort Array", j+1);
+            log_message_fmt(MSG_BUBBLE_COMPARE, nums[j], nums[j+1]);
+            log_count_compare(1);
+            log_count_read(2);
+            log_step_end();
+
+            if (nums[j] > nums[j+1]) {
+                swap(&nums[j], &nums[j+1]);
+
+                // Highlight swap
+                log_step_start();
+                log_highlight("Sort Array", j);
+                log_highlight("Sort Array", j+1);
+                log_message_fmt(MSG_BUBBLE_SWAP, nums[j+1], nums[j]);
+                log_step_end();
+            }
+        }
+        
+        // Mark sorted element? We don't have a specific way to mark "done" yet, 
+        // but it stays in place.
+    }
+}
+
+static const LogInput inputs[] = {
+    {.name = "nums", .type = LOG_INPUT_INT_LIST, .max_size = 500},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_QUADRATIC,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(bubble_sort) {
+    if (log_describe(argc, argv, &description)) return 0;
     log_init();
 
-    int nums[100];
+    // At most one value per argument, or per two characters of a list
+    int size = argc > 2 ? argc - 1 : argc == 2 ? (int)strlen(argv[1]) / 2 + 1 : 10;
+    int* nums = malloc(size * sizeof(int));
     int n = 0;
 
     if (argc > 1) {
@@ -36,47 +83,19 @@ int main(int argc, char* argv[]) {
         for(int i=0; i<n; i++) nums[i] = defaults[i];
     }
 
+    log_watch_array("Sort Array", nums, n);
+
     log_step_start();
-    log_array("Sort Array", nums, n);
     log_message("Initial Unsorted Array");
     log_step_end();
 
-    for (int i = 0; i < n - 1; i++) {
-        for (int j = 0; j < n - i - 1; j++) {
-            
-            // Highlight comparison
-            log_step_start();
-            log_array("Sort Array", nums, n);
-            log_highlight("Sort Array", j);
-            log_highlight("Sort Array", j+1);
-            char msg[128];
-            sprintf(msg, "Comparing %d and %d", nums[j], nums[j+1]);
-            log_message(msg);
-            log_step_end();
-
-            if (nums[j] > nums[j+1]) {
-                swap(&nums[j], &nums[j+1]);
-
-                // Highlight swap
-                log_step_start();
-                log_array("Sort Array", nums, n);
-                log_highlight("Sort Array", j);
-                log_highlight("Sort Array", j+1);
-                sprintf(msg, "Swapping %d and %d", nums[j+1], nums[j]);
-                log_message(msg);
-                log_step_end();
-            }
-        }
-        
-        // Mark sorted element? We don't have a specific way to mark "done" yet, 
-        // but it stays in place.
-    }
+    bubbleSort(nums, n);
 
     log_step_start();
-    log_array("Sort Array", nums, n);
     log_message("Sorting Complete!");
     log_step_end();
 
     log_finish();
+    free(nums);
     return 0;
 }
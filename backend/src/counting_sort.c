@@ -7,6 +7,8 @@ void countingSort(int arr[], int n) {
     // Find max
     int max = arr[0];
     for(int i=1; i<n; i++) if(arr[i] > max) max = arr[i];
+    log_count_compare(n - 1);
+    log_count_read(n);
     
     // Create count array
     // Beware of large max. For visualization assume small inputs.
@@ -17,13 +19,11 @@ void countingSort(int arr[], int n) {
     // Count phase
     for (int i = 0; i < n; i++) {
         count[arr[i]]++;
+        log_count_read(1);
         
         log_step_start();
-        log_array("Sort Array", arr, n);
         log_highlight("Sort Array", i);
-        char msg[128];
-        sprintf(msg, "Counting %d. Count[%d] = %d", arr[i], arr[i], count[arr[i]]);
-        log_message(msg);
+        log_message_fmt(MSG_COUNTING_COUNT, arr[i], arr[i], count[arr[i]]);
         log_step_end();
     }
 
@@ -36,6 +36,8 @@ void countingSort(int arr[], int n) {
     for (int i = n - 1; i >= 0; i--) {
         output[count[arr[i]] - 1] = arr[i];
         count[arr[i]]--;
+        log_count_read(1);
+        log_count_write(1);
         
         // Visualize the 'output' array being built? 
         // We can't overwrite 'Sort Array' easily if it's separate.
@@ -51,8 +53,9 @@ void countingSort(int arr[], int n) {
     // Copy output to arr
     for (int i = 0; i < n; i++) {
         arr[i] = output[i];
+        log_count_read(1);
+        log_count_write(1);
         log_step_start();
-        log_array("Sort Array", arr, n);
         log_highlight("Sort Array", i);
         log_message("Placing sorted element");
         log_step_end();
@@ -62,11 +65,23 @@ void countingSort(int arr[], int n) {
     free(output);
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "nums", .type = LOG_INPUT_INT_LIST, .min = 0, .max = 1000, .max_size = 500},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LINEAR,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(counting_sort) {
+    if (log_describe(argc, argv, &description)) return 0;
     if (argc < 2) return 1;
 
     char* input = argv[1];
-    int arr[100];
+    // At most one value per argument, or per two characters of a list
+    int* arr = malloc((argc > 2 ? (size_t)argc - 1 : strlen(input) / 2 + 1) * sizeof(int));
     int n = 0;
 
     if (argc > 2) {
@@ -82,20 +97,20 @@ int main(int argc, char* argv[]) {
     }
 
     log_init();
+    log_watch_array("Sort Array", arr, n);
     
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_message("Initial State");
     log_step_end();
 
     countingSort(arr, n);
     
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_message("Array Sorted!");
     log_step_end();
     
     log_finish();
+    free(arr);
 
     return 0;
 }
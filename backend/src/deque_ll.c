@@ -72,7 +72,18 @@ void dequeOperations(int* input_vals, int n) {
     }
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "values", .type = LOG_INPUT_INT_LIST, .max_size = 100},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LINEAR,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(deque_ll) {
+    if (log_describe(argc, argv, &description)) return 0;
     if (argc < 2) return 1;
 
     char* input = argv[1];
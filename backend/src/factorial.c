@@ -3,7 +3,7 @@
 #include <string.h>
 #include "../include/logger.h"
 
-int node_id_counter = 0;
+_Thread_local int node_id_counter = 0;
 
 long long factorial(int n, int parent_id) {
     int current_id = node_id_counter++;
@@ -46,13 +46,28 @@ long long factorial(int n, int parent_id) {
     return res;
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "n", .type = LOG_INPUT_INT, .min = 0, .max = 20},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LINEAR,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(factorial) {
+    if (log_describe(argc, argv, &description)) return 0;
+    // Node ids restart for every trace
+    node_id_counter = 0;
     if (argc < 2) return 1;
     
     int n = atoi(argv[1]);
 
     log_init();
-    factorial(n, -1);
+    long long result = factorial(n, -1);
+    int halves[2] = {(int)result, (int)(result >> 32)};
+    log_result(halves, 2);
     log_finish();
     return 0;
 }
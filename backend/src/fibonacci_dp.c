@@ -5,7 +5,18 @@
 // DP: Fibonacci Sequence
 // dp[i] = dp[i-1] + dp[i-2]
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "n", .type = LOG_INPUT_INT, .min = 0, .max = 20},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LINEAR,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(fibonacci_dp) {
+    if (log_describe(argc, argv, &description)) return 0;
     log_init();
 
     int n = 7; // Default N
@@ -50,6 +61,7 @@ int main(int argc, char* argv[]) {
     log_message(msg);
     log_step_end();
 
+    log_result(dp, n + 1);
     log_finish();
     return 0;
 }
@@ -8,64 +8,70 @@ void insertionSort(int arr[], int n) {
     
     // Log initial state
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_message("Initial State");
     log_step_end();
 
     for (i = 1; i < n; i++) {
         key = arr[i];
         j = i - 1;
+        log_count_read(1);
 
         log_step_start();
-        log_array("Sort Array", arr, n);
         log_highlight("Sort Array", i);
-        char msg[128];
-        sprintf(msg, "Picked key: %d. Inserting into sorted portion...", key);
-        log_message(msg);
+        log_message_fmt(MSG_INSERTION_PICK, key);
         log_step_end();
 
         /* Move elements of arr[0..i-1], that are greater than key,
            to one position ahead of their current position */
-        while (j >= 0 && arr[j] > key) {
+        while (j >= 0 && (log_count_compare(1), log_count_read(1), arr[j] > key)) {
             log_step_start();
-            log_array("Sort Array", arr, n);
             log_highlight("Sort Array", j);
             log_highlight("Sort Array", j+1); // Position being filled
-            sprintf(msg, "%d > %d, moving %d right", arr[j], key, arr[j]);
-            log_message(msg);
+            log_message_fmt(MSG_INSERTION_SHIFT, arr[j], key, arr[j]);
             log_step_end();
 
             arr[j + 1] = arr[j];
             j = j - 1;
+            log_count_read(1);
+            log_count_write(1);
             
             // Show move
             log_step_start();
-            log_array("Sort Array", arr, n);
             log_highlight("Sort Array", j+1); // Empty spot potentially
             log_message("Moved.");
             log_step_end();
         }
         arr[j + 1] = key;
+        log_count_write(1);
         
         log_step_start();
-        log_array("Sort Array", arr, n);
         log_highlight("Sort Array", j+1);
-        sprintf(msg, "Inserted key %d at position %d", key, j+1);
-        log_message(msg);
+        log_message_fmt(MSG_INSERTION_INSERT, key, j+1);
         log_step_end();
     }
     
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_message("Array Sorted!");
     log_step_end();
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "nums", .type = LOG_INPUT_INT_LIST, .max_size = 500},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_QUADRATIC,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(insertion_sort) {
+    if (log_describe(argc, argv, &description)) return 0;
     if (argc < 2) return 1;
 
     char* input = argv[1];
-    int arr[100];
+    // At most one value per argument, or per two characters of a list
+    int* arr = malloc((argc > 2 ? (size_t)argc - 1 : strlen(input) / 2 + 1) * sizeof(int));
     int n = 0;
 
     // Check if we have multiple arguments (e.g. "64" "25" "12") or single string
@@ -83,8 +89,10 @@ int main(int argc, char* argv[]) {
     }
 
     log_init();
+    log_watch_array("Sort Array", arr, n);
     insertionSort(arr, n);
     log_finish();
+    free(arr);
 
     return 0;
 }
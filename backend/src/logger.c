@@ -1,19 +1,44 @@
+// The logger itself is always built at the full level.
+#undef LOG_LEVEL
+#define LOG_LEVEL 2
+
 #include "../include/logger.h"
+#include "../include/trace_format.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
 
-int first_step = 1;
+#ifdef LOGGER_ZLIB
+#include <zlib.h>
+#endif
 
-// Structure-based implementation for valid JSON generation
+// Structure-based implementation for valid JSON generation.
+// Nothing here has a fixed capacity: everything logged for a step is carved
+// out of step_arena, while tree nodes/edges and delta snapshots, which live
+// across steps, are kept in growable heap arrays.
+//
+// All of it lives in a LogCtx, so any number of traces can be written at
+// once (one per thread, or several interleaved on one thread). The plain
+// log_*() functions work on the calling thread's context.
 
-#define MAX_ARRAYS 5
-#define MAX_VARS 10
-#define MAX_HIGHLIGHTS 10
-#define MAX_ARRAY_SIZE 100
-#define MAX_NODES 50
-#define MAX_EDGES 50
+#define DEFAULT_KEYFRAME_INTERVAL 64
+#define ARENA_MIN_BLOCK (64 * 1024)
+#define OUT_BUF_SIZE (1 << 20)
+#define CATEGORY_SLOTS 64
+#define STREAM_STRIDE_LEVELS 16
+#define MAX_MESSAGE_ARGS 16
+
+// Arrays are compared in blocks of one cache line.
+#define BLOCK_INTS (64 / (int)sizeof(int))
+#define BLOCK_TEXT (BLOCK_INTS * 13) // ", -2147483648" per value
 
 typedef struct {
     int id;
-    char label[32];
+    const char* label;
 } NodeLog;
 
 typedef struct {
@@ -22,153 +47,1989 @@ typedef struct {
 } EdgeLog;
 
 typedef struct {
-    char name[32];
-    int data[MAX_ARRAY_SIZE];
+    const char* name;
+    int* data;
     int size;
+    int watch; // index into watches when data is a watched array, else -1
 } ArrLog;
 
 typedef struct {
-    char name[32];
+    const char* name;
     int value;
 } VarLog;
 
 typedef struct {
-    char name[32];
+    const char* name;
     int index;
 } HighlightLog;
 
-ArrLog arrays[MAX_ARRAYS];
-int arr_count = 0;
+// The message of a step: plain text, or a template from log_messages.h with
+// its integer arguments, formatted only when the step is written.
+typedef struct {
+    const char* text; // the template itself when template_id >= 0
+    int template_id;  // -1 for plain text
+    int argc;
+    int* args;
+} MessageLog;
 
-VarLog vars[MAX_VARS];
-int var_count = 0;
+// Operation counts of a step: since the previous step and since log_init().
+typedef struct {
+    LogOps step;
+    LogOps total;
+    int present; // 0 until the program has counted anything
+} OpsLog;
+
+// Timing of a step (LOG_TIMING): when log_step_start() was called, relative
+// to log_init(), and the time the algorithm ran outside the logger since the
+// previous step.
+typedef struct {
+    long long start_ns;
+    long long algorithm_ns;
+    int present;
+} TimingLog;
 
-HighlightLog highlights[MAX_HIGHLIGHTS];
-int highlight_count = 0;
+// Per-step durations, kept for the percentiles in the summary.
+typedef struct {
+    long long* data;
+    long count;
+    long cap;
+} DurationList;
 
-NodeLog tree_nodes[MAX_NODES];
-int node_count = 0;
+// Bump allocator. log_step_start() rewinds step_arena; if the previous step
+// needed more than one block they are folded into a single block big enough
+// for all of it, so once the largest step has been seen the logger stops
+// allocating. label_arena holds node labels and is only rewound by log_init().
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t size;
+    size_t used;
+    char data[];
+} ArenaBlock;
 
-EdgeLog tree_edges[MAX_EDGES];
-int edge_count = 0;
+// Open-addressing hash indexes over tree_nodes (by id) and tree_edges (by
+// from/to pair) so log_node()/log_edge() dedupe in O(1). Slots hold an
+// index into the list, or -1 when empty.
+typedef struct {
+    int* slots;
+    int cap;
+} IndexSet;
 
-// Global message buffer for the step
-char current_message[256] = "";
+// Last emitted contents of an array, for delta mode.
+typedef struct {
+    char* name;
+    int* data;
+    int size;
+    int cap;
+} SnapLog;
 
-void log_init() {
-    printf("[\n");
-    first_step = 1;
-    node_count = 0;
-    edge_count = 0;
+typedef struct {
+    char* name;
+    int* data;
+    int size;
+    int* shown;              // values the cached text was rendered from
+    char* text;              // BLOCK_TEXT bytes per block
+    unsigned short* text_len;
+    int cached;
+} WatchLog;
+
+typedef struct {
+    unsigned char* data;
+    size_t len;
+    size_t cap;
+} ByteBuf;
+
+typedef struct {
+    char* text;
+    unsigned hash;
+    int id;
+} StrEntry;
+
+typedef struct {
+    unsigned hash;
+    long last_seen; // 0 = empty slot, otherwise step number + 1
+} CategoryLog;
+
+// Everything emit_step() needs to write a step, so that a step can be set
+// aside and written later.
+typedef struct {
+    ArenaBlock* arena;
+    ArrLog* arrays;
+    int arr_count;
+    int arr_cap;
+    VarLog* vars;
+    int var_count;
+    int var_cap;
+    HighlightLog* highlights;
+    int highlight_count;
+    int highlight_cap;
+    MessageLog message;
+    OpsLog ops;
+    TimingLog timing;
+    int node_count; // tree nodes/edges are append-only, so a count
+    int edge_count; // is enough to rebuild the tree as of this step
+    long index;
+    long gap; // steps since the message category last came up
+} StepState;
+
+struct LogCtx {
+    LogOptions options;
+    LogSink sink;
+    void* sink_user;
+
+    int binary_mode;
+    int ndjson_mode;
+    int summary_trailer;
+    int delta_mode;
+    int keyframe_interval;
+    int first_step;
+
+    // The step being logged
+    ArenaBlock* step_arena;
+    ArrLog* arrays;
+    int arr_count;
+    int arr_cap;
+    VarLog* vars;
+    int var_count;
+    int var_cap;
+    HighlightLog* highlights;
+    int highlight_count;
+    int highlight_cap;
+    MessageLog message; // text and arguments stored in step_arena
+    OpsLog ops;
+    LogOps ops_base; // log_ops at log_ctx_init(); the counter is shared by the thread
+    LogOps ops_prev; // counts as of the previous step, since ops_base
+    int ops_seen;
+
+    // LOG_TIMING: the clock is read on entry to and exit from every log_*()
+    // call; time inside them is the logger's (log_array() copies the array,
+    // log_step_end() writes the step, ...), time outside them the
+    // algorithm's.
+    TimingLog timing;
+    long long clock_origin;  // log_init()
+    long long clock_resumed; // last return to the algorithm
+    long long step_algorithm_ns;
+    long long step_logger_ns;
+    long long algorithm_ns;
+    long long logger_ns;
+    DurationList algorithm_steps;
+    DurationList logger_steps;
+
+    // Tree nodes/edges, kept across steps
+    ArenaBlock* label_arena;
+    NodeLog* tree_nodes;
+    int node_count;
+    int node_cap;
+    EdgeLog* tree_edges;
+    int edge_count;
+    int edge_cap;
+    IndexSet node_index;
+    IndexSet edge_index;
+    // Delta mode writes each node/edge once, in the step that added it.
+    int nodes_emitted;
+    int edges_emitted;
+
+    // Delta mode
+    SnapLog* snapshots;
+    int snapshot_count;
+    int snapshot_cap;
+    int step_index;
+
+    WatchLog* watches;
+    int watch_count;
+    int watch_cap;
+
+    // Binary mode
+    int step_keyframe;
+    ByteBuf step_buf;
+    ByteBuf string_buf;
+    StrEntry* str_table;
+    int str_cap;
+    int str_count;
+
+    // Step budget; slots past sample_count keep arenas of dropped samples
+    // for reuse.
+    long max_steps;
+    long head_steps;
+    long steps_logged;
+    long steps_kept;
+    CategoryLog categories[CATEGORY_SLOTS];
+    StepState* samples;
+    int sample_count;
+    int sample_cap;
+    int sample_alloc;
+    long sample_stride;
+    int samples_streamed;
+    StepState pending_step;
+    int have_pending;
+
+    ByteBuf summary_buf;
+    int summary_fields;
+
+#ifdef LOGGER_ZLIB
+    z_stream gzip_stream;
+    int gzip_active;
+    unsigned char gzip_buf[1 << 16];
+#endif
+    size_t out_len;
+    char out_buf[OUT_BUF_SIZE];
+};
+
+static const char* const message_templates[] = {
+#define LOG_MESSAGE_TEXT(id, text) text,
+    LOG_MESSAGE_TEMPLATES(LOG_MESSAGE_TEXT)
+#undef LOG_MESSAGE_TEXT
+};
+
+static const MessageLog no_message = {"", -1, 0, NULL};
+
+_Thread_local LogOps log_ops;
+
+static _Thread_local LogFailureHandler failure_handler = NULL;
+
+void log_on_failure(LogFailureHandler handler) {
+    failure_handler = handler;
 }
 
-void log_message(const char* message) {
-    strncpy(current_message, message, 255);
+// The logger cannot go on; does not return.
+static void log_fail(const char* reason) {
+    if (failure_handler != NULL) failure_handler(reason);
+    fprintf(stderr, "logger: %s\n", reason);
+    exit(1);
 }
 
-void log_step_start() {
-    if (!first_step) {
-        printf(",\n");
-    }
-    printf("  {\n");
-    first_step = 0;
-    arr_count = 0;
-    var_count = 0;
-    highlight_count = 0;
-    // node_count and edge_count are persistent for tree growing
-    current_message[0] = '\0';
+// On failure the old block is left where it was, so a context abandoned
+// halfway through growing something still frees cleanly.
+static void* xrealloc(void* p, size_t size) {
+    p = realloc(p, size);
+    if (p == NULL) log_fail("out of memory");
+    return p;
 }
 
-void log_array(const char* name, int* arr, int size) {
-    if (arr_count < MAX_ARRAYS) {
-        strncpy(arrays[arr_count].name, name, 31);
-        arrays[arr_count].size = (size > MAX_ARRAY_SIZE) ? MAX_ARRAY_SIZE : size;
-        for(int i=0; i<arrays[arr_count].size; i++) {
-            arrays[arr_count].data[i] = arr[i];
+static char* xstrdup(const char* s) {
+    size_t len = strlen(s) + 1;
+    return memcpy(xrealloc(NULL, len), s, len);
+}
+
+static void* arena_alloc(ArenaBlock** arena, size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    ArenaBlock* b = *arena;
+    if (b == NULL || b->used + size > b->size) {
+        size_t block_size = b ? b->size * 2 : ARENA_MIN_BLOCK;
+        while (block_size < size) block_size *= 2;
+        ArenaBlock* nb = xrealloc(NULL, sizeof(ArenaBlock) + block_size);
+        nb->next = b;
+        nb->size = block_size;
+        nb->used = 0;
+        *arena = b = nb;
+    }
+    void* p = b->data + b->used;
+    b->used += size;
+    return p;
+}
+
+static void arena_reset(ArenaBlock** arena) {
+    ArenaBlock* b = *arena;
+    if (b == NULL) return;
+    if (b->next != NULL) {
+        size_t total = 0;
+        while (b != NULL) {
+            ArenaBlock* next = b->next;
+            total += b->size;
+            free(b);
+            b = next;
         }
-        arr_count++;
+        *arena = NULL;
+        b = xrealloc(NULL, sizeof(ArenaBlock) + total);
+        b->next = NULL;
+        b->size = total;
+        *arena = b;
     }
+    b->used = 0;
 }
 
-void log_var(const char* name, int value) {
-    if (var_count < MAX_VARS) {
-        strncpy(vars[var_count].name, name, 31);
-        vars[var_count].value = value;
-        var_count++;
+static void arena_free(ArenaBlock** arena) {
+    while (*arena != NULL) {
+        ArenaBlock* next = (*arena)->next;
+        free(*arena);
+        *arena = next;
     }
 }
 
-void log_highlight(const char* name, int index) {
-    if (highlight_count < MAX_HIGHLIGHTS) {
-        strncpy(highlights[highlight_count].name, name, 31);
-        highlights[highlight_count].index = index;
-        highlight_count++;
+static uint64_t node_key(LogCtx* ctx, int i) {
+    return (uint32_t)ctx->tree_nodes[i].id;
+}
+
+static uint64_t edge_key(LogCtx* ctx, int i) {
+    return ((uint64_t)(uint32_t)ctx->tree_edges[i].from << 32) | (uint32_t)ctx->tree_edges[i].to;
+}
+
+static unsigned hash_key(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    return (unsigned)k;
+}
+
+// Returns the slot holding key, or the empty slot where it would go. The
+// set must have at least one empty slot.
+static int* index_lookup(LogCtx* ctx, IndexSet* set, uint64_t key, uint64_t (*key_of)(LogCtx*, int)) {
+    unsigned mask = set->cap - 1;
+    unsigned pos = hash_key(key) & mask;
+    while (set->slots[pos] >= 0 && key_of(ctx, set->slots[pos]) != key) pos = (pos + 1) & mask;
+    return &set->slots[pos];
+}
+
+// Keeps the load factor at or below 1/2 before count + 1 entries are stored.
+static void index_reserve(LogCtx* ctx, IndexSet* set, int count, uint64_t (*key_of)(LogCtx*, int)) {
+    if ((count + 1) * 2 <= set->cap) return;
+    int cap = set->cap ? set->cap * 2 : 256;
+    while ((count + 1) * 2 > cap) cap *= 2;
+    int* slots = xrealloc(NULL, cap * sizeof(int));
+    free(set->slots);
+    set->slots = slots;
+    set->cap = cap;
+    memset(set->slots, 0xff, cap * sizeof(int));
+    for (int i = 0; i < count; i++) *index_lookup(ctx, set, key_of(ctx, i), key_of) = i;
+}
+
+static void index_clear(IndexSet* set) {
+    if (set->slots != NULL) memset(set->slots, 0xff, set->cap * sizeof(int));
+}
+
+static void index_free(IndexSet* set) {
+    free(set->slots);
+    set->slots = NULL;
+    set->cap = 0;
+}
+
+static const char* arena_strdup(ArenaBlock** arena, const char* s) {
+    size_t len = strlen(s) + 1;
+    char* copy = arena_alloc(arena, len);
+    memcpy(copy, s, len);
+    return copy;
+}
+
+// Makes room for one more element in a list stored in step_arena.
+static void* step_list_grow(LogCtx* ctx, void* items, int count, int* cap, size_t elem) {
+    if (count < *cap) return items;
+    int new_cap = *cap ? *cap * 2 : 8;
+    void* grown = arena_alloc(&ctx->step_arena, new_cap * elem);
+    if (count) memcpy(grown, items, count * elem);
+    *cap = new_cap;
+    return grown;
+}
+
+// Output writer. The trace is serialized into one large buffer with
+// hand-rolled integer formatting and handed to the kernel in big write()
+// calls, instead of one stdio call per element.
+static const char digit_pairs[] = "00010203040506070809"
+                                  "10111213141516171819"
+                                  "20212223242526272829"
+                                  "30313233343536373839"
+                                  "40414243444546474849"
+                                  "50515253545556575859"
+                                  "60616263646566676869"
+                                  "70717273747576777879"
+                                  "80818283848586878889"
+                                  "90919293949596979899";
+
+// The default sink.
+static void write_fully(void* user, const void* buf, size_t len) {
+    const char* data = buf;
+    (void)user;
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            // Reader went away (e.g. the server timed us out); nothing to do.
+            return;
+        }
+        data += n;
+        len -= n;
     }
 }
 
-void log_node(int id, const char* label) {
-    // Prevent duplicates
-    for (int i = 0; i < node_count; i++) {
-        if (tree_nodes[i].id == id) return;
+// Optional gzip compression of the whole stream (LOG_COMPRESS=gzip), so the
+// reader can hand it on to an HTTP client as is. Only available when the
+// logger is built with LOGGER_ZLIB (the Makefile does, and links -lz).
+#ifdef LOGGER_ZLIB
+static void gzip_write(LogCtx* ctx, const void* data, size_t len, int flush) {
+    ctx->gzip_stream.next_in = (Bytef*)data;
+    ctx->gzip_stream.avail_in = len;
+    do {
+        ctx->gzip_stream.next_out = ctx->gzip_buf;
+        ctx->gzip_stream.avail_out = sizeof(ctx->gzip_buf);
+        deflate(&ctx->gzip_stream, flush);
+        size_t produced = sizeof(ctx->gzip_buf) - ctx->gzip_stream.avail_out;
+        if (produced > 0) ctx->sink(ctx->sink_user, ctx->gzip_buf, produced);
+    } while (ctx->gzip_stream.avail_out == 0);
+}
+#endif
+
+static void out_write(LogCtx* ctx, const void* data, size_t len) {
+    if (len == 0) return;
+#ifdef LOGGER_ZLIB
+    if (ctx->gzip_active) {
+        gzip_write(ctx, data, len, Z_NO_FLUSH);
+        return;
     }
-    if (node_count < MAX_NODES) {
-        tree_nodes[node_count].id = id;
-        strncpy(tree_nodes[node_count].label, label, 31);
-        node_count++;
+#endif
+    ctx->sink(ctx->sink_user, data, len);
+}
+
+static void out_flush(LogCtx* ctx) {
+    out_write(ctx, ctx->out_buf, ctx->out_len);
+    ctx->out_len = 0;
+}
+
+// Like out_flush(), but also pushes out whatever the compressor is holding
+// back, so the reader can decode everything written so far.
+static void out_sync(LogCtx* ctx) {
+    out_flush(ctx);
+#ifdef LOGGER_ZLIB
+    if (ctx->gzip_active) gzip_write(ctx, NULL, 0, Z_SYNC_FLUSH);
+#endif
+}
+
+// Final flush; ends the compressed stream.
+static void out_close(LogCtx* ctx) {
+    out_flush(ctx);
+#ifdef LOGGER_ZLIB
+    if (ctx->gzip_active) {
+        gzip_write(ctx, NULL, 0, Z_FINISH);
+        deflateEnd(&ctx->gzip_stream);
+        ctx->gzip_active = 0;
     }
+#endif
 }
 
-void log_edge(int from_id, int to_id) {
+// LOG_COMPRESS=gzip
+static void out_start_compression(LogCtx* ctx) {
+#ifdef LOGGER_ZLIB
+    memset(&ctx->gzip_stream, 0, sizeof(ctx->gzip_stream));
+    // windowBits 15 + 16 selects the gzip wrapper instead of raw zlib.
+    if (deflateInit2(&ctx->gzip_stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        log_fail("cannot initialize gzip compression");
+    }
+    ctx->gzip_active = 1;
+#else
+    (void)ctx;
+    log_fail("LOG_COMPRESS=gzip needs a logger built with LOGGER_ZLIB");
+#endif
+}
+
+static void out_bytes(LogCtx* ctx, const void* data, size_t len) {
+    if (ctx->out_len + len > OUT_BUF_SIZE) {
+        out_flush(ctx);
+        if (len > OUT_BUF_SIZE) {
+            out_write(ctx, data, len);
+            return;
+        }
+    }
+    memcpy(ctx->out_buf + ctx->out_len, data, len);
+    ctx->out_len += len;
+}
+
+#define out_lit(ctx, s) out_bytes(ctx, s, sizeof(s) - 1)
+
+static void out_str(LogCtx* ctx, const char* s) {
+    out_bytes(ctx, s, strlen(s));
+}
+
+static void out_char(LogCtx* ctx, char c) {
+    if (ctx->out_len == OUT_BUF_SIZE) out_flush(ctx);
+    ctx->out_buf[ctx->out_len++] = c;
+}
+
+// Formats value so that it ends just before end; returns its first char.
+static char* format_int(char* end, int value) {
+    char* p = end;
+    unsigned v = value < 0 ? 0u - (unsigned)value : (unsigned)value;
+
+    while (v >= 100) {
+        unsigned pair = (v % 100) * 2;
+        v /= 100;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    if (v >= 10) {
+        *--p = digit_pairs[v * 2 + 1];
+        *--p = digit_pairs[v * 2];
+    } else {
+        *--p = (char)('0' + v);
+    }
+    if (value < 0) *--p = '-';
+    return p;
+}
+
+static void out_int(LogCtx* ctx, int value) {
+    char tmp[12];
+    char* p = format_int(tmp + sizeof(tmp), value);
+    out_bytes(ctx, p, tmp + sizeof(tmp) - p);
+}
+
+// "name": as used for every object member in the JSON format
+static void out_key(LogCtx* ctx, const char* name) {
+    out_char(ctx, '"');
+    out_str(ctx, name);
+    out_lit(ctx, "\": ");
+}
+
+// Starts a member of a step object: one per line in the JSON format, all on
+// one line in NDJSON.
+static void out_member(LogCtx* ctx, const char* name, int first) {
+    if (ctx->ndjson_mode) {
+        if (!first) out_lit(ctx, ", ");
+    } else {
+        if (!first) out_lit(ctx, ",\n");
+        out_lit(ctx, "    ");
+    }
+    out_key(ctx, name);
+}
+
+// Writes a message's text, filling in a template's %d conversions.
+static void out_message(LogCtx* ctx, const MessageLog* m) {
+    if (m->template_id < 0) {
+        out_str(ctx, m->text);
+        return;
+    }
+    const char* p = m->text;
+    int arg = 0;
+    for (;;) {
+        const char* conv = strchr(p, '%');
+        if (conv == NULL) break;
+        out_bytes(ctx, p, conv - p);
+        if (conv[1] == 'd' && arg < m->argc) {
+            out_int(ctx, m->args[arg++]);
+        } else if (conv[1] == '%') {
+            out_char(ctx, '%');
+        }
+        p = conv + (conv[1] ? 2 : 1);
+    }
+    out_str(ctx, p);
+}
+
+// Delta trace mode (LOG_DELTA=1). The logger remembers the last emitted
+// contents of each named array and only writes the indices that changed,
+// as {"set": [index, value, ...]}. Every LOG_KEYFRAME steps a keyframe is
+// written: snapshots are dropped and every array is emitted in full, so a
+// reader can rebuild any step starting from the nearest keyframe.
+static SnapLog* find_snapshot(LogCtx* ctx, const char* name) {
+    for (int i = 0; i < ctx->snapshot_count; i++) {
+        if (strcmp(ctx->snapshots[i].name, name) == 0) return &ctx->snapshots[i];
+    }
+    return NULL;
+}
+
+static void print_array_full(LogCtx* ctx, const ArrLog* a) {
+    out_char(ctx, '[');
+    for (int j = 0; j < a->size; j++) {
+        if (j) out_lit(ctx, ", ");
+        out_int(ctx, a->data[j]);
+    }
+    out_char(ctx, ']');
+}
+
+// Compares an array against its snapshot and brings the snapshot up to date.
+// Writes the changed (index, value) pairs into changes (room for 2 * size
+// ints) and returns how many pairs there are, or -1 when the array has to be
+// written in full (first sighting since the last keyframe, or size change).
+static int diff_array(LogCtx* ctx, const ArrLog* a, int* changes) {
+    SnapLog* snap = find_snapshot(ctx, a->name);
+
+    if (snap != NULL && snap->size == a->size) {
+        // Whole cache-line-sized blocks are compared first; only blocks
+        // that changed are scanned for the individual indices.
+        int n = 0;
+        for (int start = 0; start < a->size; start += BLOCK_INTS) {
+            int end = start + BLOCK_INTS < a->size ? start + BLOCK_INTS : a->size;
+            if (memcmp(snap->data + start, a->data + start, (end - start) * sizeof(int)) == 0) {
+                continue;
+            }
+            for (int j = start; j < end; j++) {
+                if (snap->data[j] != a->data[j]) {
+                    changes[2 * n] = j;
+                    changes[2 * n + 1] = a->data[j];
+                    snap->data[j] = a->data[j];
+                    n++;
+                }
+            }
+        }
+        return n;
+    }
+
+    if (snap == NULL) {
+        if (ctx->snapshot_count == ctx->snapshot_cap) {
+            int cap = ctx->snapshot_cap ? ctx->snapshot_cap * 2 : 8;
+            ctx->snapshots = xrealloc(ctx->snapshots, cap * sizeof(SnapLog));
+            memset(ctx->snapshots + ctx->snapshot_cap, 0, (cap - ctx->snapshot_cap) * sizeof(SnapLog));
+            ctx->snapshot_cap = cap;
+        }
+        // Slots past snapshot_count keep their buffers from before the last
+        // keyframe, only the name has to be replaced.
+        snap = &ctx->snapshots[ctx->snapshot_count++];
+        char* name = xstrdup(a->name);
+        free(snap->name);
+        snap->name = name;
+    }
+    if (a->size > snap->cap) {
+        snap->cap = a->size;
+        snap->data = xrealloc(snap->data, snap->cap * sizeof(int));
+    }
+    snap->size = a->size;
+    if (a->size > 0) memcpy(snap->data, a->data, a->size * sizeof(int));
+    return -1;
+}
+
+static void free_snapshots(LogCtx* ctx) {
+    for (int i = 0; i < ctx->snapshot_cap; i++) {
+        free(ctx->snapshots[i].name);
+        free(ctx->snapshots[i].data);
+    }
+    free(ctx->snapshots);
+    ctx->snapshots = NULL;
+    ctx->snapshot_count = 0;
+    ctx->snapshot_cap = 0;
+}
+
+static void print_array_delta(LogCtx* ctx, const ArrLog* a) {
+    int* changes = arena_alloc(&ctx->step_arena, 2 * a->size * sizeof(int));
+    int n = diff_array(ctx, a, changes);
+    if (n < 0) {
+        print_array_full(ctx, a);
+        return;
+    }
+    out_lit(ctx, "{\"set\": [");
+    for (int j = 0; j < n; j++) {
+        if (j) out_lit(ctx, ", ");
+        out_int(ctx, changes[2 * j]);
+        out_lit(ctx, ", ");
+        out_int(ctx, changes[2 * j + 1]);
+    }
+    out_lit(ctx, "]}");
+}
+
+// Arrays registered with log_watch_array() are read in place when a step is
+// written instead of being copied at every step. For the full JSON formats
+// the rendered text of every block is cached along with the values it was
+// rendered from, so a step only formats the blocks that changed since.
+
+static WatchLog* find_watch(LogCtx* ctx, const char* name) {
+    for (int i = 0; i < ctx->watch_count; i++) {
+        if (strcmp(ctx->watches[i].name, name) == 0) return &ctx->watches[i];
+    }
+    return NULL;
+}
+
+static void free_watch(WatchLog* w) {
+    free(w->name);
+    free(w->shown);
+    free(w->text);
+    free(w->text_len);
+}
+
+// Renders values as ", v" each; returns the length.
+static int render_block(char* text, const int* values, int count) {
+    char* p = text;
+    for (int j = 0; j < count; j++) {
+        char tmp[12];
+        char* digits = format_int(tmp + sizeof(tmp), values[j]);
+        *p++ = ',';
+        *p++ = ' ';
+        memcpy(p, digits, tmp + sizeof(tmp) - digits);
+        p += tmp + sizeof(tmp) - digits;
+    }
+    return p - text;
+}
+
+static void print_watched_full(LogCtx* ctx, WatchLog* w) {
+    out_char(ctx, '[');
+    for (int b = 0, start = 0; start < w->size; b++, start += BLOCK_INTS) {
+        int count = w->size - start < BLOCK_INTS ? w->size - start : BLOCK_INTS;
+        char* text = w->text + (size_t)b * BLOCK_TEXT;
+        if (!w->cached || memcmp(w->shown + start, w->data + start, count * sizeof(int)) != 0) {
+            memcpy(w->shown + start, w->data + start, count * sizeof(int));
+            w->text_len[b] = render_block(text, w->data + start, count);
+        }
+        // The first value has no separator in front of it.
+        if (b == 0) {
+            out_bytes(ctx, text + 2, w->text_len[b] - 2);
+        } else {
+            out_bytes(ctx, text, w->text_len[b]);
+        }
+    }
+    w->cached = 1;
+    out_char(ctx, ']');
+}
+
+// Puts the watched arrays in front of the arrays logged for this step,
+// except those the step logged itself under the same name. They are read
+// in place; hold_step() snapshots them for steps that are written later.
+static void add_watched_arrays(LogCtx* ctx) {
+    if (ctx->watch_count == 0) return;
+    ArrLog* list = arena_alloc(&ctx->step_arena, (ctx->watch_count + ctx->arr_count) * sizeof(ArrLog));
+    int n = 0;
+    for (int i = 0; i < ctx->watch_count; i++) {
+        WatchLog* w = &ctx->watches[i];
+        int logged = 0;
+        for (int j = 0; j < ctx->arr_count && !logged; j++) logged = strcmp(ctx->arrays[j].name, w->name) == 0;
+        if (logged) continue;
+
+        ArrLog* a = &list[n++];
+        a->name = w->name;
+        a->size = w->size;
+        a->watch = i;
+        a->data = w->data;
+    }
+    if (ctx->arr_count > 0) memcpy(list + n, ctx->arrays, ctx->arr_count * sizeof(ArrLog));
+    ctx->arrays = list;
+    ctx->arr_count += n;
+    ctx->arr_cap = ctx->arr_count;
+}
+
+// The pending step reads watched arrays in place (see hold_step()). Before
+// watch i is replaced or removed, the step gets its own copy of it;
+// removed says the watches after it move down by one.
+static void detach_pending(LogCtx* ctx, int watch, int removed) {
+    if (!ctx->have_pending) return;
+    StepState* s = &ctx->pending_step;
+    for (int i = 0; i < s->arr_count; i++) {
+        ArrLog* a = &s->arrays[i];
+        if (a->watch > watch && removed) a->watch--;
+        if (a->watch != watch) continue;
+        int* data = arena_alloc(&s->arena, a->size * sizeof(int));
+        if (a->size > 0) memcpy(data, a->data, a->size * sizeof(int));
+        a->name = arena_strdup(&s->arena, a->name);
+        a->data = data;
+        a->watch = -1;
+    }
+}
+
+static void free_watches(LogCtx* ctx) {
+    for (int i = 0; i < ctx->watch_count; i++) free_watch(&ctx->watches[i]);
+    free(ctx->watches);
+    ctx->watches = NULL;
+    ctx->watch_count = 0;
+    ctx->watch_cap = 0;
+}
+
+// Binary trace mode (LOG_FORMAT=binary), see trace_format.h. Each step is
+// encoded into step_buf; strings seen for the first time go to string_buf
+// and are written just ahead of the step that uses them.
+
+static void buf_reserve(ByteBuf* b, size_t extra) {
+    if (b->len + extra <= b->cap) return;
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + extra) cap *= 2;
+    b->data = xrealloc(b->data, cap);
+    b->cap = cap;
+}
+
+static void put_bytes(ByteBuf* b, const void* p, size_t n) {
+    buf_reserve(b, n);
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+}
+
+static void put_u8(ByteBuf* b, unsigned v) {
+    unsigned char c = (unsigned char)v;
+    put_bytes(b, &c, 1);
+}
+
+static void put_u16(ByteBuf* b, unsigned v) {
+    unsigned char c[2] = {(unsigned char)v, (unsigned char)(v >> 8)};
+    put_bytes(b, c, 2);
+}
+
+static void put_u32(ByteBuf* b, unsigned v) {
+    unsigned char c[4] = {(unsigned char)v, (unsigned char)(v >> 8), (unsigned char)(v >> 16),
+                          (unsigned char)(v >> 24)};
+    put_bytes(b, c, 4);
+}
+
+static void put_i64(ByteBuf* b, long long v) {
+    put_u32(b, (unsigned)v);
+    put_u32(b, (unsigned)((unsigned long long)v >> 32));
+}
+
+static void put_ops(ByteBuf* b, const LogOps* ops) {
+    put_i64(b, ops->comparisons);
+    put_i64(b, ops->swaps);
+    put_i64(b, ops->reads);
+    put_i64(b, ops->writes);
+}
+
+static unsigned hash_string(const char* s) {
+    unsigned h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Returns the string table id of s, defining it in string_buf on first use.
+static int intern_string(LogCtx* ctx, const char* s) {
+    if (ctx->str_count * 2 >= ctx->str_cap) {
+        int old_cap = ctx->str_cap;
+        StrEntry* old = ctx->str_table;
+        int cap = old_cap ? old_cap * 2 : 256;
+        ctx->str_table = xrealloc(NULL, cap * sizeof(StrEntry));
+        ctx->str_cap = cap;
+        memset(ctx->str_table, 0, ctx->str_cap * sizeof(StrEntry));
+        for (int i = 0; i < old_cap; i++) {
+            if (old[i].text == NULL) continue;
+            int slot = old[i].hash & (ctx->str_cap - 1);
+            while (ctx->str_table[slot].text != NULL) slot = (slot + 1) & (ctx->str_cap - 1);
+            ctx->str_table[slot] = old[i];
+        }
+        free(old);
+    }
+
+    unsigned h = hash_string(s);
+    int slot = h & (ctx->str_cap - 1);
+    while (ctx->str_table[slot].text != NULL) {
+        if (ctx->str_table[slot].hash == h && strcmp(ctx->str_table[slot].text, s) == 0) {
+            return ctx->str_table[slot].id;
+        }
+        slot = (slot + 1) & (ctx->str_cap - 1);
+    }
+
+    size_t len = strlen(s);
+    ctx->str_table[slot].text = xstrdup(s);
+    ctx->str_table[slot].hash = h;
+    ctx->str_table[slot].id = ctx->str_count++;
+
+    put_u8(&ctx->string_buf, TRACE_REC_STRING);
+    put_u32(&ctx->string_buf, (unsigned)len);
+    put_bytes(&ctx->string_buf, s, len);
+    return ctx->str_table[slot].id;
+}
+
+static void free_strings(LogCtx* ctx) {
+    for (int i = 0; i < ctx->str_cap; i++) free(ctx->str_table[i].text);
+    free(ctx->str_table);
+    ctx->str_table = NULL;
+    ctx->str_cap = 0;
+    ctx->str_count = 0;
+}
+
+// Picks the narrowest column type that can hold every value of the array.
+static int column_width(const ArrLog* a) {
+    int width = TRACE_COL_I8;
+    for (int j = 0; j < a->size; j++) {
+        int v = a->data[j];
+        if (v < -32768 || v > 32767) return TRACE_COL_I32;
+        if (v < -128 || v > 127) width = TRACE_COL_I16;
+    }
+    return width;
+}
+
+static void encode_array(LogCtx* ctx, const ArrLog* a) {
+    int* changes = NULL;
+    int n = -1;
+    if (ctx->delta_mode) {
+        changes = arena_alloc(&ctx->step_arena, 2 * a->size * sizeof(int));
+        n = diff_array(ctx, a, changes);
+    }
+
+    put_u32(&ctx->step_buf, intern_string(ctx, a->name));
+    if (n >= 0) {
+        put_u8(&ctx->step_buf, TRACE_COL_DELTA);
+        put_u32(&ctx->step_buf, n);
+        for (int j = 0; j < n; j++) {
+            put_u32(&ctx->step_buf, changes[2 * j]);
+            put_u32(&ctx->step_buf, changes[2 * j + 1]);
+        }
+        return;
+    }
+
+    int width = column_width(a);
+    put_u8(&ctx->step_buf, width);
+    put_u32(&ctx->step_buf, a->size);
+
+    // Column values are written straight into the reserved buffer space.
+    buf_reserve(&ctx->step_buf, (size_t)a->size * width);
+    unsigned char* p = ctx->step_buf.data + ctx->step_buf.len;
+    for (int j = 0; j < a->size; j++) {
+        unsigned v = (unsigned)a->data[j];
+        *p++ = (unsigned char)v;
+        if (width >= TRACE_COL_I16) *p++ = (unsigned char)(v >> 8);
+        if (width == TRACE_COL_I32) {
+            *p++ = (unsigned char)(v >> 16);
+            *p++ = (unsigned char)(v >> 24);
+        }
+    }
+    ctx->step_buf.len = p - ctx->step_buf.data;
+}
+
+static void encode_step(LogCtx* ctx) {
+    ctx->step_buf.len = 0;
+    ctx->string_buf.len = 0;
+
+    put_u8(&ctx->step_buf, TRACE_REC_STEP);
+    const MessageLog* m = &ctx->message;
+    put_u8(&ctx->step_buf, (ctx->step_keyframe ? TRACE_STEP_KEYFRAME : 0) |
+                               (m->template_id >= 0 ? TRACE_STEP_TEMPLATE : 0) |
+                               (ctx->ops.present ? TRACE_STEP_OPS : 0) |
+                               (ctx->timing.present ? TRACE_STEP_TIMING : 0));
+
+    put_u32(&ctx->step_buf, ctx->arr_count);
+    for (int i = 0; i < ctx->arr_count; i++) encode_array(ctx, &ctx->arrays[i]);
+
+    put_u32(&ctx->step_buf, ctx->var_count);
+    for (int i = 0; i < ctx->var_count; i++) {
+        put_u32(&ctx->step_buf, intern_string(ctx, ctx->vars[i].name));
+        put_u32(&ctx->step_buf, ctx->vars[i].value);
+    }
+
+    put_u32(&ctx->step_buf, ctx->highlight_count);
+    for (int i = 0; i < ctx->highlight_count; i++) {
+        put_u32(&ctx->step_buf, intern_string(ctx, ctx->highlights[i].name));
+        put_u32(&ctx->step_buf, ctx->highlights[i].index);
+    }
+
+    int first_node = ctx->delta_mode ? ctx->nodes_emitted : 0;
+    put_u32(&ctx->step_buf, ctx->node_count - first_node);
+    for (int i = first_node; i < ctx->node_count; i++) {
+        put_u32(&ctx->step_buf, ctx->tree_nodes[i].id);
+        put_u32(&ctx->step_buf, intern_string(ctx, ctx->tree_nodes[i].label));
+    }
+
+    int first_edge = ctx->delta_mode ? ctx->edges_emitted : 0;
+    put_u32(&ctx->step_buf, ctx->edge_count - first_edge);
+    for (int i = first_edge; i < ctx->edge_count; i++) {
+        put_u32(&ctx->step_buf, ctx->tree_edges[i].from);
+        put_u32(&ctx->step_buf, ctx->tree_edges[i].to);
+    }
+
+    put_u32(&ctx->step_buf, intern_string(ctx, m->text));
+    if (m->template_id >= 0) {
+        put_u32(&ctx->step_buf, m->argc);
+        for (int i = 0; i < m->argc; i++) put_u32(&ctx->step_buf, m->args[i]);
+    }
+    if (ctx->ops.present) {
+        put_ops(&ctx->step_buf, &ctx->ops.step);
+        put_ops(&ctx->step_buf, &ctx->ops.total);
+    }
+    if (ctx->timing.present) {
+        put_i64(&ctx->step_buf, ctx->timing.start_ns);
+        put_i64(&ctx->step_buf, ctx->timing.algorithm_ns);
+    }
+
+    out_bytes(ctx, ctx->string_buf.data, ctx->string_buf.len);
+    out_bytes(ctx, ctx->step_buf.data, ctx->step_buf.len);
+}
+
+// Step budget (LOG_MAX_STEPS=N). The first N/2 steps are written as they
+// are logged. Later steps are sampled into a reservoir of the remaining
+// budget: every k-th step is kept, plus any step whose message category has
+// not come up in the last k steps. Whenever the reservoir fills up, k
+// doubles and the samples that no longer qualify are dropped, so the
+// samples stay spread over the whole run however long it gets. The
+// reservoir and the last step (always kept) are written by log_finish(),
+// followed by a summary record with the number of dropped steps. Runs of at
+// most N steps come out unchanged.
+//
+// NDJSON output is read while it is written, so there the samples go out
+// as they are taken instead: the stride starts at 1 and doubles after each
+// 1/STREAM_STRIDE_LEVELS of the sample budget, so the samples thin out the
+// longer the run gets, and once the budget is spent only the last step is
+// still written (by log_finish()).
+
+// A message's category is its text up to the first digit, '[', ':' or '%',
+// so "Comparing 3 and 5" and "Comparing 8 and 1" fall in the same category,
+// and so do all the messages of a template.
+static unsigned message_category(const char* message) {
+    unsigned h = 2166136261u;
+    for (const char* p = message; *p && !(*p >= '0' && *p <= '9') && *p != '[' && *p != ':' && *p != '%';
+         p++) {
+        h = (h ^ (unsigned char)*p) * 16777619u;
+    }
+    return h;
+}
+
+// Records that the category of message came up at step index and returns
+// how many steps ago it last did (index + 1 if never).
+static long category_gap(LogCtx* ctx, const char* message, long index) {
+    unsigned h = message_category(message);
+    unsigned pos = h % CATEGORY_SLOTS;
+    for (int probe = 0; probe < CATEGORY_SLOTS; probe++) {
+        CategoryLog* c = &ctx->categories[(pos + probe) % CATEGORY_SLOTS];
+        if (c->last_seen == 0 || c->hash == h) {
+            long gap = index + 1 - c->last_seen;
+            c->hash = h;
+            c->last_seen = index + 1;
+            return gap;
+        }
+    }
+    // Table full: too many categories to tell apart, keep to the stride.
+    return 0;
+}
+
+static void budget_reset(LogCtx* ctx) {
+    ctx->max_steps = ctx->options.max_steps > 0 ? ctx->options.max_steps : 0;
+    ctx->head_steps = ctx->max_steps / 2;
+    ctx->steps_logged = 0;
+    ctx->steps_kept = 0;
+    memset(ctx->categories, 0, sizeof(ctx->categories));
+
+    // One slot of the budget is reserved for the last step. Thinning needs
+    // room for at least two samples; smaller budgets go to the head.
+    ctx->sample_cap = ctx->max_steps - ctx->head_steps - 1;
+    if (ctx->sample_cap < 2) {
+        ctx->head_steps = ctx->max_steps > 0 ? ctx->max_steps - 1 : 0;
+        ctx->sample_cap = 0;
+    }
+    if (!ctx->ndjson_mode && ctx->sample_cap > ctx->sample_alloc) {
+        ctx->samples = xrealloc(ctx->samples, ctx->sample_cap * sizeof(StepState));
+        memset(ctx->samples + ctx->sample_alloc, 0, (ctx->sample_cap - ctx->sample_alloc) * sizeof(StepState));
+        ctx->sample_alloc = ctx->sample_cap;
+    }
+    ctx->sample_count = 0;
+    ctx->sample_stride = 1;
+    ctx->samples_streamed = 0;
+    ctx->have_pending = 0;
+}
+
+// Exchanges the step being logged with *other.
+static void swap_step_state(LogCtx* ctx, StepState* other) {
+    StepState cur = {ctx->step_arena, ctx->arrays, ctx->arr_count, ctx->arr_cap,
+                     ctx->vars, ctx->var_count, ctx->var_cap,
+                     ctx->highlights, ctx->highlight_count, ctx->highlight_cap,
+                     ctx->message, ctx->ops, ctx->timing, ctx->node_count, ctx->edge_count, other->index, other->gap};
+    ctx->step_arena = other->arena;
+    ctx->arrays = other->arrays;
+    ctx->arr_count = other->arr_count;
+    ctx->arr_cap = other->arr_cap;
+    ctx->vars = other->vars;
+    ctx->var_count = other->var_count;
+    ctx->var_cap = other->var_cap;
+    ctx->highlights = other->highlights;
+    ctx->highlight_count = other->highlight_count;
+    ctx->highlight_cap = other->highlight_cap;
+    ctx->message = other->message;
+    ctx->ops = other->ops;
+    ctx->timing = other->timing;
+    *other = cur;
+}
+
+static int sample_wanted(LogCtx* ctx, long index, long gap) {
+    return (index - ctx->head_steps) % ctx->sample_stride == 0 || gap > ctx->sample_stride;
+}
+
+// Doubles the stride until the reservoir has room again. The sample at
+// the start of the reservoir always survives, every other one eventually
+// stops qualifying, so with two or more slots this terminates.
+static void thin_samples(LogCtx* ctx) {
+    while (ctx->sample_count == ctx->sample_cap && ctx->sample_stride < LONG_MAX / 2) {
+        ctx->sample_stride *= 2;
+        int kept = 0;
+        for (int i = 0; i < ctx->sample_count; i++) {
+            if (!sample_wanted(ctx, ctx->samples[i].index, ctx->samples[i].gap)) continue;
+            StepState t = ctx->samples[kept];
+            ctx->samples[kept++] = ctx->samples[i];
+            ctx->samples[i] = t;
+        }
+        ctx->sample_count = kept;
+    }
+}
+
+// Sets the step being logged aside in *slot, for log_finish() to write.
+// A sample gets a copy of the watched arrays. The pending step keeps
+// reading them in place: it is dropped at the next step past the head, so
+// most steps of a budgeted run copy nothing, and the one left pending at
+// log_finish() is the trace's last step.
+static void hold_step(LogCtx* ctx, StepState* slot, long index, long gap) {
+    // The arena swapped in from the slot is rewound by log_step_start().
+    swap_step_state(ctx, slot);
+    for (int i = 0; slot != &ctx->pending_step && i < slot->arr_count; i++) {
+        ArrLog* a = &slot->arrays[i];
+        if (a->watch < 0) continue;
+        int* data = arena_alloc(&slot->arena, a->size * sizeof(int));
+        if (a->size > 0) memcpy(data, a->data, a->size * sizeof(int));
+        a->name = arena_strdup(&slot->arena, a->name);
+        a->data = data;
+        a->watch = -1;
+    }
+    slot->node_count = ctx->node_count;
+    slot->edge_count = ctx->edge_count;
+    slot->index = index;
+    slot->gap = gap;
+    ctx->have_pending = slot == &ctx->pending_step;
+}
+
+// Takes the step being logged past the head of the budget.
+static void sample_step(LogCtx* ctx, long index, long gap) {
+    StepState* slot = &ctx->pending_step;
+    if (ctx->sample_cap > 0 && sample_wanted(ctx, index, gap)) {
+        if (ctx->sample_count == ctx->sample_cap) thin_samples(ctx);
+        if (ctx->sample_count < ctx->sample_cap && sample_wanted(ctx, index, gap)) slot = &ctx->samples[ctx->sample_count++];
+    }
+    hold_step(ctx, slot, index, gap);
+}
+
+static void emit_step(LogCtx* ctx);
+
+// sample_step() for NDJSON: a sample is written at once (see above).
+static void stream_sample_step(LogCtx* ctx, long index, long gap) {
+    if (ctx->samples_streamed < ctx->sample_cap && sample_wanted(ctx, index, gap)) {
+        int level = ctx->sample_cap / STREAM_STRIDE_LEVELS;
+        add_watched_arrays(ctx);
+        emit_step(ctx);
+        ctx->have_pending = 0;
+        if (++ctx->samples_streamed % (level > 0 ? level : 1) == 0 && ctx->sample_stride < LONG_MAX / 2) {
+            ctx->sample_stride *= 2;
+        }
+        return;
+    }
+    add_watched_arrays(ctx);
+    hold_step(ctx, &ctx->pending_step, index, gap);
+}
+
+// Writes a step set aside by sample_step(); *s keeps its arena.
+static void emit_saved_step(LogCtx* ctx, StepState* s) {
+    int nodes = ctx->node_count;
+    int edges = ctx->edge_count;
+    swap_step_state(ctx, s);
+    ctx->node_count = s->node_count;
+    ctx->edge_count = s->edge_count;
+    emit_step(ctx);
+    swap_step_state(ctx, s);
+    ctx->node_count = nodes;
+    ctx->edge_count = edges;
+}
+
+static void out_long(LogCtx* ctx, long long value) {
+    char tmp[24];
+    int n = snprintf(tmp, sizeof(tmp), "%lld", value);
+    out_bytes(ctx, tmp, n);
+}
+
+static void out_ops(LogCtx* ctx, const LogOps* ops) {
+    out_lit(ctx, "{\"comparisons\": ");
+    out_long(ctx, ops->comparisons);
+    out_lit(ctx, ", \"swaps\": ");
+    out_long(ctx, ops->swaps);
+    out_lit(ctx, ", \"reads\": ");
+    out_long(ctx, ops->reads);
+    out_lit(ctx, ", \"writes\": ");
+    out_long(ctx, ops->writes);
+    out_char(ctx, '}');
+}
+
+// Trailing summary record: named totals for the whole run. In JSON it is a
+// last array element of the form {"summary": {...}}, or with
+// LOG_SUMMARY=trailer the bare object after the end of the trace (see
+// log_ctx_finish()).
+
+static void summary_begin(LogCtx* ctx) {
+    ctx->summary_fields = 0;
+    if (ctx->binary_mode) {
+        ctx->string_buf.len = 0;
+        ctx->summary_buf.len = 0;
+        return;
+    }
+    if (ctx->ndjson_mode) {
+        out_lit(ctx, "{\"summary\": {");
+        return;
+    }
+    if (ctx->summary_trailer) {
+        out_char(ctx, '{');
+        return;
+    }
+    if (!ctx->first_step) out_lit(ctx, ",\n");
+    out_lit(ctx, "  {\n    \"summary\": {");
+    ctx->first_step = 0;
+}
+
+static void summary_field(LogCtx* ctx, const char* name, long long value) {
+    if (ctx->binary_mode) {
+        put_u32(&ctx->summary_buf, intern_string(ctx, name));
+        put_i64(&ctx->summary_buf, value);
+    } else {
+        if (ctx->summary_fields) out_lit(ctx, ", ");
+        out_key(ctx, name);
+        out_long(ctx, value);
+    }
+    ctx->summary_fields++;
+}
+
+static void summary_end(LogCtx* ctx) {
+    if (ctx->binary_mode) {
+        // Names interned by summary_field() are pending in string_buf.
+        out_bytes(ctx, ctx->string_buf.data, ctx->string_buf.len);
+        ctx->step_buf.len = 0;
+        put_u8(&ctx->step_buf, TRACE_REC_SUMMARY);
+        put_u32(&ctx->step_buf, ctx->summary_fields);
+        out_bytes(ctx, ctx->step_buf.data, ctx->step_buf.len);
+        out_bytes(ctx, ctx->summary_buf.data, ctx->summary_buf.len);
+    } else if (ctx->ndjson_mode) {
+        out_lit(ctx, "}}\n");
+    } else if (ctx->summary_trailer) {
+        out_char(ctx, '}');
+    } else {
+        out_lit(ctx, "}\n  }");
+    }
+}
+
+// Step timing (LOG_TIMING)
+
+static long long clock_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void durations_add(DurationList* list, long long ns) {
+    if (list->count == list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 256;
+        list->data = xrealloc(list->data, list->cap * sizeof(long long));
+    }
+    list->data[list->count++] = ns;
+}
+
+static void timing_reset(LogCtx* ctx) {
+    ctx->timing = (TimingLog){0};
+    ctx->step_algorithm_ns = ctx->step_logger_ns = 0;
+    ctx->algorithm_ns = ctx->logger_ns = 0;
+    ctx->algorithm_steps.count = 0;
+    ctx->logger_steps.count = 0;
+    if (ctx->options.timing) ctx->clock_origin = ctx->clock_resumed = clock_ns();
+}
+
+// The algorithm calls into the logger: the time since it last returned was
+// the algorithm's. Returns the current time, 0 when timing is off.
+static long long timing_enter(LogCtx* ctx) {
+    if (!ctx->options.timing) return 0;
+    long long now = clock_ns();
+    ctx->step_algorithm_ns += now - ctx->clock_resumed;
+    ctx->algorithm_ns += now - ctx->clock_resumed;
+    return now;
+}
+
+// Back to the algorithm after a logger call that started at entered.
+static void timing_leave(LogCtx* ctx, long long entered) {
+    if (!ctx->options.timing) return;
+    long long now = clock_ns();
+    ctx->step_logger_ns += now - entered;
+    ctx->logger_ns += now - entered;
+    ctx->clock_resumed = now;
+}
+
+static int compare_ns(const void* a, const void* b) {
+    long long x = *(const long long*)a;
+    long long y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+// Writes name_p50, _p90, _p99 and _max of the per-step durations
+// (nearest rank; sorts the list).
+static void summary_percentiles(LogCtx* ctx, const char* name, DurationList* list) {
+    static const int percents[] = {50, 90, 99};
+    char key[64];
+    if (list->count == 0) return;
+    qsort(list->data, list->count, sizeof(long long), compare_ns);
+    for (int i = 0; i < 3; i++) {
+        long rank = (list->count * percents[i] + 99) / 100;
+        snprintf(key, sizeof(key), "%s_p%d", name, percents[i]);
+        summary_field(ctx, key, list->data[rank > 0 ? rank - 1 : 0]);
+    }
+    snprintf(key, sizeof(key), "%s_max", name);
+    summary_field(ctx, key, list->data[list->count - 1]);
+}
+
+// Totals from log_init() to the summary (log_finish() having been entered
+// at finish_entered), then the per-step distributions.
+static void summary_timing(LogCtx* ctx, long long finish_entered) {
+    summary_field(ctx, "algorithm_ns", ctx->algorithm_ns);
+    summary_field(ctx, "logger_ns", ctx->logger_ns + (clock_ns() - finish_entered));
+    summary_percentiles(ctx, "step_algorithm_ns", &ctx->algorithm_steps);
+    summary_percentiles(ctx, "step_logger_ns", &ctx->logger_steps);
+}
+
+int log_option_set(LogOptions* options, const char* name, const char* value) {
+    if (strcmp(name, "LOG_FORMAT") == 0) {
+        options->format = LOG_FORMAT_JSON;
+        if (strcmp(value, "binary") == 0) options->format = LOG_FORMAT_BINARY;
+        if (strcmp(value, "ndjson") == 0) options->format = LOG_FORMAT_NDJSON;
+    } else if (strcmp(name, "LOG_DELTA") == 0) {
+        options->delta = atoi(value) != 0;
+    } else if (strcmp(name, "LOG_KEYFRAME") == 0) {
+        options->keyframe_interval = *value ? atoi(value) : DEFAULT_KEYFRAME_INTERVAL;
+        if (options->keyframe_interval < 1) options->keyframe_interval = 1;
+    } else if (strcmp(name, "LOG_MAX_STEPS") == 0) {
+        options->max_steps = atoi(value);
+    } else if (strcmp(name, "LOG_COMPRESS") == 0) {
+        options->gzip = strcmp(value, "gzip") == 0;
+    } else if (strcmp(name, "LOG_TIMING") == 0) {
+        options->timing = atoi(value) != 0;
+    } else if (strcmp(name, "LOG_SUMMARY") == 0) {
+        options->summary_trailer = strcmp(value, "trailer") == 0;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+void log_options_from_env(LogOptions* options) {
+    static const char* const names[] = {"LOG_FORMAT", "LOG_DELTA", "LOG_KEYFRAME",
+                                        "LOG_MAX_STEPS", "LOG_COMPRESS", "LOG_TIMING", "LOG_SUMMARY"};
+    memset(options, 0, sizeof(*options));
+    options->keyframe_interval = DEFAULT_KEYFRAME_INTERVAL;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        const char* value = getenv(names[i]);
+        if (value != NULL) log_option_set(options, names[i], value);
+    }
+}
+
+LogCtx* log_ctx_create(const LogOptions* options, LogSink sink, void* user) {
+    // calloc: the output buffer is only touched as far as it gets used.
+    LogCtx* ctx = calloc(1, sizeof(LogCtx));
+    if (ctx == NULL) {
+        fprintf(stderr, "logger: out of memory\n");
+        exit(1);
+    }
+    if (options != NULL) ctx->options = *options;
+    ctx->sink = sink != NULL ? sink : write_fully;
+    ctx->sink_user = user;
+    ctx->message = no_message;
+    ctx->first_step = 1;
+    return ctx;
+}
+
+void log_ctx_set_options(LogCtx* ctx, const LogOptions* options) {
+    ctx->options = *options;
+}
+
+void log_ctx_init(LogCtx* ctx) {
+    const LogOptions* o = &ctx->options;
+    ctx->binary_mode = o->format == LOG_FORMAT_BINARY;
+    ctx->ndjson_mode = o->format == LOG_FORMAT_NDJSON;
+    ctx->summary_trailer = o->summary_trailer && o->format == LOG_FORMAT_JSON;
+    ctx->delta_mode = o->delta != 0;
+    ctx->keyframe_interval = o->keyframe_interval > 0 ? o->keyframe_interval : DEFAULT_KEYFRAME_INTERVAL;
+
+    ctx->out_len = 0;
+    if (o->gzip) out_start_compression(ctx);
+
+    if (ctx->binary_mode) {
+        ByteBuf header = {0};
+        put_bytes(&header, TRACE_MAGIC, 4);
+        put_u16(&header, TRACE_VERSION);
+        put_u16(&header, ctx->delta_mode ? TRACE_FLAG_DELTA : 0);
+        out_bytes(ctx, header.data, header.len);
+        free(header.data);
+    } else if (!ctx->ndjson_mode) {
+        out_lit(ctx, "[\n");
+    }
+    ctx->first_step = 1;
+    ctx->node_count = 0;
+    ctx->edge_count = 0;
+    ctx->nodes_emitted = 0;
+    ctx->edges_emitted = 0;
+    index_clear(&ctx->node_index);
+    index_clear(&ctx->edge_index);
+    arena_reset(&ctx->label_arena);
+    ctx->step_index = 0;
+    ctx->snapshot_count = 0;
+    // A context may be reused for another trace: watched arrays belong to
+    // the previous run, and binary string ids start over.
+    free_watches(ctx);
+    free_strings(ctx);
+    budget_reset(ctx);
+    ctx->ops_base = log_ops;
+    ctx->ops_prev = (LogOps){0};
+    ctx->ops_seen = 0;
+    timing_reset(ctx);
+}
+
+void log_ctx_message(LogCtx* ctx, const char* message) {
+    long long entered = timing_enter(ctx);
+    ctx->message = no_message;
+    ctx->message.text = arena_strdup(&ctx->step_arena, message);
+    timing_leave(ctx, entered);
+}
+
+static void message_vfmt(LogCtx* ctx, int template_id, va_list ap) {
+    ctx->message = no_message;
+    if (template_id < 0 || template_id >= LOG_MESSAGE_COUNT) return;
+
+    // Only the arguments are stored; the text is formatted when (and if)
+    // the step gets written.
+    const char* text = message_templates[template_id];
+    int argc = 0;
+    for (const char* p = strchr(text, '%'); p != NULL; p = strchr(p + 2, '%')) {
+        if (p[1] == 'd' && argc < MAX_MESSAGE_ARGS) argc++;
+        if (p[1] == '\0') break;
+    }
+    int* args = arena_alloc(&ctx->step_arena, (argc ? argc : 1) * sizeof(int));
+    for (int i = 0; i < argc; i++) args[i] = va_arg(ap, int);
+
+    ctx->message.text = text;
+    ctx->message.template_id = template_id;
+    ctx->message.argc = argc;
+    ctx->message.args = args;
+}
+
+// message_vfmt() as logger time, for both log_ctx_message_fmt() and the
+// plain log_message_fmt().
+static void timed_message_vfmt(LogCtx* ctx, int template_id, va_list ap) {
+    long long entered = timing_enter(ctx);
+    message_vfmt(ctx, template_id, ap);
+    timing_leave(ctx, entered);
+}
+
+void log_ctx_message_fmt(LogCtx* ctx, int template_id, ...) {
+    va_list ap;
+    va_start(ap, template_id);
+    timed_message_vfmt(ctx, template_id, ap);
+    va_end(ap);
+}
+
+void log_ctx_step_start(LogCtx* ctx) {
+    long long entered = timing_enter(ctx);
+    arena_reset(&ctx->step_arena);
+    ctx->arrays = NULL;
+    ctx->arr_count = ctx->arr_cap = 0;
+    ctx->vars = NULL;
+    ctx->var_count = ctx->var_cap = 0;
+    ctx->highlights = NULL;
+    ctx->highlight_count = ctx->highlight_cap = 0;
+    // node_count and edge_count are persistent for tree growing
+    ctx->message = no_message;
+    if (ctx->options.timing) ctx->timing.start_ns = entered - ctx->clock_origin;
+    timing_leave(ctx, entered);
+}
+
+void log_ctx_array(LogCtx* ctx, const char* name, int* arr, int size) {
+    long long entered = timing_enter(ctx);
+    if (size < 0) size = 0;
+    ctx->arrays = step_list_grow(ctx, ctx->arrays, ctx->arr_count, &ctx->arr_cap, sizeof(ArrLog));
+    ArrLog* a = &ctx->arrays[ctx->arr_count++];
+    a->name = arena_strdup(&ctx->step_arena, name);
+    a->size = size;
+    a->watch = -1;
+    a->data = arena_alloc(&ctx->step_arena, size * sizeof(int));
+    if (size > 0) memcpy(a->data, arr, size * sizeof(int));
+    timing_leave(ctx, entered);
+}
+
+void log_ctx_watch_array(LogCtx* ctx, const char* name, int* arr, int size) {
+    long long entered = timing_enter(ctx);
+    if (size < 0) size = 0;
+    WatchLog* w = find_watch(ctx, name);
+    if (w == NULL) {
+        if (ctx->watch_count == ctx->watch_cap) {
+            ctx->watch_cap = ctx->watch_cap ? ctx->watch_cap * 2 : 4;
+            ctx->watches = xrealloc(ctx->watches, ctx->watch_cap * sizeof(WatchLog));
+        }
+        w = &ctx->watches[ctx->watch_count++];
+        memset(w, 0, sizeof(*w));
+        w->name = xstrdup(name);
+    } else {
+        detach_pending(ctx, w - ctx->watches, 0);
+    }
+    int blocks = (size + BLOCK_INTS - 1) / BLOCK_INTS;
+    if (size != w->size || w->shown == NULL) {
+        w->shown = xrealloc(w->shown, (size ? size : 1) * sizeof(int));
+        w->text = xrealloc(w->text, (blocks ? blocks : 1) * BLOCK_TEXT);
+        w->text_len = xrealloc(w->text_len, (blocks ? blocks : 1) * sizeof(unsigned short));
+    }
+    w->data = arr;
+    w->size = size;
+    w->cached = 0;
+    timing_leave(ctx, entered);
+}
+
+void log_ctx_unwatch_array(LogCtx* ctx, const char* name) {
+    long long entered = timing_enter(ctx);
+    WatchLog* w = find_watch(ctx, name);
+    if (w != NULL) {
+        int i = w - ctx->watches;
+        detach_pending(ctx, i, 1);
+        free_watch(w);
+        memmove(w, w + 1, (ctx->watch_count - i - 1) * sizeof(WatchLog));
+        ctx->watch_count--;
+    }
+    timing_leave(ctx, entered);
+}
+
+void log_ctx_var(LogCtx* ctx, const char* name, int value) {
+    long long entered = timing_enter(ctx);
+    ctx->vars = step_list_grow(ctx, ctx->vars, ctx->var_count, &ctx->var_cap, sizeof(VarLog));
+    ctx->vars[ctx->var_count].name = arena_strdup(&ctx->step_arena, name);
+    ctx->vars[ctx->var_count].value = value;
+    ctx->var_count++;
+    timing_leave(ctx, entered);
+}
+
+void log_ctx_highlight(LogCtx* ctx, const char* name, int index) {
+    long long entered = timing_enter(ctx);
+    ctx->highlights = step_list_grow(ctx, ctx->highlights, ctx->highlight_count, &ctx->highlight_cap, sizeof(HighlightLog));
+    ctx->highlights[ctx->highlight_count].name = arena_strdup(&ctx->step_arena, name);
+    ctx->highlights[ctx->highlight_count].index = index;
+    ctx->highlight_count++;
+    timing_leave(ctx, entered);
+}
+
+static void add_node(LogCtx* ctx, int id, const char* label) {
     // Prevent duplicates
-    for (int i = 0; i < edge_count; i++) {
-        if (tree_edges[i].from == from_id && tree_edges[i].to == to_id) return;
+    index_reserve(ctx, &ctx->node_index, ctx->node_count, node_key);
+    int* slot = index_lookup(ctx, &ctx->node_index, (uint32_t)id, node_key);
+    if (*slot >= 0) return;
+
+    if (ctx->node_count == ctx->node_cap) {
+        ctx->node_cap = ctx->node_cap ? ctx->node_cap * 2 : 64;
+        ctx->tree_nodes = xrealloc(ctx->tree_nodes, ctx->node_cap * sizeof(NodeLog));
     }
-    if (edge_count < MAX_EDGES) {
-        tree_edges[edge_count].from = from_id;
-        tree_edges[edge_count].to = to_id;
-        edge_count++;
+    ctx->tree_nodes[ctx->node_count].id = id;
+    ctx->tree_nodes[ctx->node_count].label = arena_strdup(&ctx->label_arena, label);
+    *slot = ctx->node_count++;
+}
+
+void log_ctx_node(LogCtx* ctx, int id, const char* label) {
+    long long entered = timing_enter(ctx);
+    add_node(ctx, id, label);
+    timing_leave(ctx, entered);
+}
+
+static void add_edge(LogCtx* ctx, int from_id, int to_id) {
+    // Prevent duplicates
+    uint64_t key = ((uint64_t)(uint32_t)from_id << 32) | (uint32_t)to_id;
+    index_reserve(ctx, &ctx->edge_index, ctx->edge_count, edge_key);
+    int* slot = index_lookup(ctx, &ctx->edge_index, key, edge_key);
+    if (*slot >= 0) return;
+
+    if (ctx->edge_count == ctx->edge_cap) {
+        ctx->edge_cap = ctx->edge_cap ? ctx->edge_cap * 2 : 64;
+        ctx->tree_edges = xrealloc(ctx->tree_edges, ctx->edge_cap * sizeof(EdgeLog));
     }
+    ctx->tree_edges[ctx->edge_count].from = from_id;
+    ctx->tree_edges[ctx->edge_count].to = to_id;
+    *slot = ctx->edge_count++;
 }
 
-void log_step_end() {
-    printf("    \"arrays\": {");
-    for (int i = 0; i < arr_count; i++) {
-        printf("\"%s\": [", arrays[i].name);
-        for (int j = 0; j < arrays[i].size; j++) {
-            printf("%d%s", arrays[i].data[j], (j < arrays[i].size - 1) ? ", " : "");
+void log_ctx_edge(LogCtx* ctx, int from_id, int to_id) {
+    long long entered = timing_enter(ctx);
+    add_edge(ctx, from_id, to_id);
+    timing_leave(ctx, entered);
+}
+
+// Writes the step currently held in the step lists.
+static void emit_step(LogCtx* ctx) {
+    ctx->step_keyframe = ctx->delta_mode && ctx->step_index % ctx->keyframe_interval == 0;
+    if (ctx->step_keyframe) ctx->snapshot_count = 0;
+    ctx->step_index++;
+    ctx->steps_kept++;
+
+    if (ctx->binary_mode) {
+        encode_step(ctx);
+        ctx->nodes_emitted = ctx->node_count;
+        ctx->edges_emitted = ctx->edge_count;
+        return;
+    }
+
+    if (ctx->ndjson_mode) {
+        out_char(ctx, '{');
+    } else {
+        if (!ctx->first_step) {
+            out_lit(ctx, ",\n");
         }
-        printf("]%s", (i < arr_count - 1) ? ", " : "");
+        out_lit(ctx, "  {\n");
+    }
+    ctx->first_step = 0;
+    if (ctx->step_keyframe) {
+        out_member(ctx, "keyframe", 1);
+        out_lit(ctx, "true");
+    }
+
+    out_member(ctx, "arrays", !ctx->step_keyframe);
+    out_char(ctx, '{');
+    for (int i = 0; i < ctx->arr_count; i++) {
+        if (i) out_lit(ctx, ", ");
+        out_key(ctx, ctx->arrays[i].name);
+        if (ctx->delta_mode) {
+            print_array_delta(ctx, &ctx->arrays[i]);
+        } else if (ctx->arrays[i].watch >= 0) {
+            print_watched_full(ctx, &ctx->watches[ctx->arrays[i].watch]);
+        } else {
+            print_array_full(ctx, &ctx->arrays[i]);
+        }
+    }
+    out_char(ctx, '}');
+
+    out_member(ctx, "variables", 0);
+    out_char(ctx, '{');
+    for (int i = 0; i < ctx->var_count; i++) {
+        if (i) out_lit(ctx, ", ");
+        out_key(ctx, ctx->vars[i].name);
+        out_int(ctx, ctx->vars[i].value);
+    }
+    out_char(ctx, '}');
+
+    out_member(ctx, "highlights", 0);
+    out_char(ctx, '{');
+    for (int i = 0; i < ctx->highlight_count; i++) {
+        if (i) out_lit(ctx, ", ");
+        out_key(ctx, ctx->highlights[i].name);
+        out_int(ctx, ctx->highlights[i].index);
+    }
+    out_char(ctx, '}');
+
+    int first_node = ctx->delta_mode ? ctx->nodes_emitted : 0;
+    out_member(ctx, ctx->delta_mode ? "nodes_added" : "nodes", 0);
+    out_char(ctx, '[');
+    for (int i = first_node; i < ctx->node_count; i++) {
+        if (i > first_node) out_lit(ctx, ", ");
+        out_lit(ctx, "{\"id\": ");
+        out_int(ctx, ctx->tree_nodes[i].id);
+        out_lit(ctx, ", \"label\": \"");
+        out_str(ctx, ctx->tree_nodes[i].label);
+        out_lit(ctx, "\"}");
+    }
+    out_char(ctx, ']');
+
+    int first_edge = ctx->delta_mode ? ctx->edges_emitted : 0;
+    out_member(ctx, ctx->delta_mode ? "edges_added" : "edges", 0);
+    out_char(ctx, '[');
+    for (int i = first_edge; i < ctx->edge_count; i++) {
+        if (i > first_edge) out_lit(ctx, ", ");
+        out_lit(ctx, "{\"from\": ");
+        out_int(ctx, ctx->tree_edges[i].from);
+        out_lit(ctx, ", \"to\": ");
+        out_int(ctx, ctx->tree_edges[i].to);
+        out_char(ctx, '}');
+    }
+    out_char(ctx, ']');
+
+    out_member(ctx, "message", 0);
+    out_char(ctx, '"');
+    out_message(ctx, &ctx->message);
+    out_char(ctx, '"');
+
+    if (ctx->ops.present) {
+        out_member(ctx, "ops", 0);
+        out_ops(ctx, &ctx->ops.step);
+        out_member(ctx, "ops_total", 0);
+        out_ops(ctx, &ctx->ops.total);
     }
-    printf("},\n");
+    if (ctx->timing.present) {
+        out_member(ctx, "timing", 0);
+        out_lit(ctx, "{\"start_ns\": ");
+        out_long(ctx, ctx->timing.start_ns);
+        out_lit(ctx, ", \"algorithm_ns\": ");
+        out_long(ctx, ctx->timing.algorithm_ns);
+        out_char(ctx, '}');
+    }
+
+    if (ctx->ndjson_mode) {
+        // One line per step, handed to the reader as soon as it is complete.
+        out_lit(ctx, "}\n");
+        out_sync(ctx);
+    } else {
+        out_lit(ctx, "\n  }");
+    }
+    ctx->nodes_emitted = ctx->node_count;
+    ctx->edges_emitted = ctx->edge_count;
+}
+
+// What the thread counted since the context's log_ctx_init()
+static LogOps ops_since_init(const LogCtx* ctx) {
+    return (LogOps){log_ops.comparisons - ctx->ops_base.comparisons, log_ops.swaps - ctx->ops_base.swaps,
+                    log_ops.reads - ctx->ops_base.reads, log_ops.writes - ctx->ops_base.writes};
+}
+
+static int ops_counted(const LogCtx* ctx) {
+    LogOps t = ops_since_init(ctx);
+    return (t.comparisons | t.swaps | t.reads | t.writes) != 0;
+}
 
-    printf("    \"variables\": {");
-    for (int i = 0; i < var_count; i++) {
-        printf("\"%s\": %d%s", vars[i].name, vars[i].value, (i < var_count - 1) ? ", " : "");
+// Takes the operation counts of the step from log_ops.
+static void count_step_ops(LogCtx* ctx) {
+    LogOps t = ops_since_init(ctx);
+    if (!ctx->ops_seen) ctx->ops_seen = ops_counted(ctx);
+    ctx->ops.present = ctx->ops_seen;
+    if (!ctx->ops_seen) return;
+    ctx->ops.total = t;
+    ctx->ops.step.comparisons = t.comparisons - ctx->ops_prev.comparisons;
+    ctx->ops.step.swaps = t.swaps - ctx->ops_prev.swaps;
+    ctx->ops.step.reads = t.reads - ctx->ops_prev.reads;
+    ctx->ops.step.writes = t.writes - ctx->ops_prev.writes;
+    ctx->ops_prev = t;
+}
+
+static void end_step(LogCtx* ctx) {
+    long index = ctx->steps_logged++;
+    count_step_ops(ctx);
+    if (ctx->max_steps <= 0) {
+        add_watched_arrays(ctx);
+        emit_step(ctx);
+        return;
+    }
+    long gap = category_gap(ctx, ctx->message.text, index);
+    if (index < ctx->head_steps) {
+        add_watched_arrays(ctx);
+        emit_step(ctx);
+    } else if (ctx->ndjson_mode) {
+        stream_sample_step(ctx, index, gap);
+    } else {
+        add_watched_arrays(ctx);
+        sample_step(ctx, index, gap);
     }
-    printf("},\n");
+}
+
+void log_ctx_step_end(LogCtx* ctx) {
+    if (!ctx->options.timing) {
+        end_step(ctx);
+        return;
+    }
+    long long entered = timing_enter(ctx);
+    ctx->timing.algorithm_ns = ctx->step_algorithm_ns;
+    ctx->timing.present = 1;
+    end_step(ctx);
+    timing_leave(ctx, entered);
+
+    // The step's times are complete once its serialization is done.
+    durations_add(&ctx->algorithm_steps, ctx->step_algorithm_ns);
+    durations_add(&ctx->logger_steps, ctx->step_logger_ns);
+    ctx->step_algorithm_ns = 0;
+    ctx->step_logger_ns = 0;
+}
+
+// Releases everything the context allocated, so a finished run leaves
+// nothing behind for valgrind to report.
+static void release_storage(LogCtx* ctx) {
+    arena_free(&ctx->step_arena);
+    arena_free(&ctx->pending_step.arena);
+    ctx->pending_step = (StepState){0};
+    for (int i = 0; i < ctx->sample_alloc; i++) arena_free(&ctx->samples[i].arena);
+    free(ctx->samples);
+    ctx->samples = NULL;
+    ctx->sample_count = ctx->sample_cap = ctx->sample_alloc = 0;
+    arena_free(&ctx->label_arena);
+    index_free(&ctx->node_index);
+    index_free(&ctx->edge_index);
+    ctx->arrays = NULL;
+    ctx->arr_count = ctx->arr_cap = 0;
+    ctx->vars = NULL;
+    ctx->var_count = ctx->var_cap = 0;
+    ctx->highlights = NULL;
+    ctx->highlight_count = ctx->highlight_cap = 0;
+    ctx->message = no_message;
+
+    free(ctx->tree_nodes);
+    ctx->tree_nodes = NULL;
+    ctx->node_count = ctx->node_cap = 0;
+    free(ctx->tree_edges);
+    ctx->tree_edges = NULL;
+    ctx->edge_count = ctx->edge_cap = 0;
+
+    free_snapshots(ctx);
+    free_watches(ctx);
+    free(ctx->step_buf.data);
+    free(ctx->string_buf.data);
+    free(ctx->summary_buf.data);
+    free(ctx->algorithm_steps.data);
+    free(ctx->logger_steps.data);
+    ctx->algorithm_steps = (DurationList){0};
+    ctx->logger_steps = (DurationList){0};
+    ctx->step_buf = (ByteBuf){0};
+    ctx->string_buf = (ByteBuf){0};
+    ctx->summary_buf = (ByteBuf){0};
+    free_strings(ctx);
+}
+
+static void write_summary(LogCtx* ctx, long long finish_entered) {
+    summary_begin(ctx);
+    if (ctx->max_steps > 0) {
+        summary_field(ctx, "steps", ctx->steps_logged);
+        summary_field(ctx, "steps_kept", ctx->steps_kept);
+        summary_field(ctx, "steps_dropped", ctx->steps_logged - ctx->steps_kept);
+    }
+    if (ctx->ops_seen) {
+        // Includes whatever was counted after the last step.
+        LogOps t = ops_since_init(ctx);
+        summary_field(ctx, "comparisons", t.comparisons);
+        summary_field(ctx, "swaps", t.swaps);
+        summary_field(ctx, "reads", t.reads);
+        summary_field(ctx, "writes", t.writes);
+    }
+    if (ctx->options.timing) summary_timing(ctx, finish_entered);
+    summary_end(ctx);
+}
+
+void log_ctx_finish(LogCtx* ctx) {
+    long long entered = timing_enter(ctx);
+    for (int i = 0; i < ctx->sample_count; i++) emit_saved_step(ctx, &ctx->samples[i]);
+    if (ctx->have_pending) emit_saved_step(ctx, &ctx->pending_step);
+    ctx->sample_count = 0;
+    ctx->have_pending = 0;
+    if (!ctx->ops_seen) ctx->ops_seen = ops_counted(ctx);
+    int summary = ctx->max_steps > 0 || ctx->ops_seen || ctx->options.timing;
+    if (summary && !ctx->summary_trailer) write_summary(ctx, entered);
 
-    printf("    \"highlights\": {");
-    for (int i = 0; i < highlight_count; i++) {
-        printf("\"%s\": %d%s", highlights[i].name, highlights[i].index, (i < highlight_count - 1) ? ", " : "");
+    if (ctx->binary_mode) {
+        out_char(ctx, (char)TRACE_REC_END);
+    } else if (!ctx->ndjson_mode) {
+        out_lit(ctx, "\n]\n");
     }
-    printf("},\n");
+    out_close(ctx);
 
-    printf("    \"nodes\": [");
-    for (int i = 0; i < node_count; i++) {
-        printf("{\"id\": %d, \"label\": \"%s\"}%s", tree_nodes[i].id, tree_nodes[i].label, (i < node_count - 1) ? ", " : "");
+    if (summary && ctx->summary_trailer) {
+        // Past the end of the compressed stream, if any: out_close() left
+        // the buffer empty, so it holds just the summary object.
+        write_summary(ctx, entered);
+        unsigned len = (unsigned)ctx->out_len;
+        unsigned char footer[8] = {len & 0xff, (len >> 8) & 0xff, (len >> 16) & 0xff, len >> 24, 'T', 'S', 'U', 'M'};
+        out_bytes(ctx, footer, sizeof(footer));
+        out_flush(ctx);
     }
-    printf("],\n");
+}
+
+void log_ctx_destroy(LogCtx* ctx) {
+    if (ctx == NULL) return;
+    out_close(ctx);
+    release_storage(ctx);
+    free(ctx);
+}
+
+void log_ctx_abandon(LogCtx* ctx) {
+    if (ctx == NULL) return;
+#ifdef LOGGER_ZLIB
+    if (ctx->gzip_active) deflateEnd(&ctx->gzip_stream);
+#endif
+    release_storage(ctx);
+    free(ctx);
+}
+
+// The plain API: each thread logs to the context bound with log_bind_ctx(),
+// or else to one that log_init() creates from the environment and writes to
+// stdout, and log_finish() destroys.
+static _Thread_local LogCtx* thread_ctx = NULL;
+static _Thread_local int thread_ctx_owned = 0;
+static int exit_registered = 0;
+
+// Make sure a program that returns without log_finish() still gets its
+// buffered steps out.
+static void flush_at_exit() {
+    if (thread_ctx != NULL) out_close(thread_ctx);
+}
+
+void log_bind_ctx(LogCtx* ctx) {
+    if (thread_ctx_owned) log_ctx_destroy(thread_ctx);
+    thread_ctx = ctx;
+    thread_ctx_owned = 0;
+}
 
-    printf("    \"edges\": [");
-    for (int i = 0; i < edge_count; i++) {
-        printf("{\"from\": %d, \"to\": %d}%s", tree_edges[i].from, tree_edges[i].to, (i < edge_count - 1) ? ", " : "");
+LogCtx* log_current_ctx() {
+    return thread_ctx;
+}
+
+void log_init() {
+    if (thread_ctx == NULL) {
+        LogOptions options;
+        log_options_from_env(&options);
+        thread_ctx = log_ctx_create(&options, NULL, NULL);
+        thread_ctx_owned = 1;
+        if (!exit_registered) {
+            atexit(flush_at_exit);
+            exit_registered = 1;
+        }
     }
-    printf("],\n");
+    log_ctx_init(thread_ctx);
+}
+
+void log_message(const char* message) {
+    if (thread_ctx != NULL) log_ctx_message(thread_ctx, message);
+}
+
+void log_message_fmt(int template_id, ...) {
+    if (thread_ctx == NULL) return;
+    va_list ap;
+    va_start(ap, template_id);
+    timed_message_vfmt(thread_ctx, template_id, ap);
+    va_end(ap);
+}
+
+void log_step_start() {
+    if (thread_ctx != NULL) log_ctx_step_start(thread_ctx);
+}
+
+void log_array(const char* name, int* arr, int size) {
+    if (thread_ctx != NULL) log_ctx_array(thread_ctx, name, arr, size);
+}
+
+void log_watch_array(const char* name, int* arr, int size) {
+    if (thread_ctx != NULL) log_ctx_watch_array(thread_ctx, name, arr, size);
+}
+
+void log_unwatch_array(const char* name) {
+    if (thread_ctx != NULL) log_ctx_unwatch_array(thread_ctx, name);
+}
+
+void log_var(const char* name, int value) {
+    if (thread_ctx != NULL) log_ctx_var(thread_ctx, name, value);
+}
+
+void log_highlight(const char* name, int index) {
+    if (thread_ctx != NULL) log_ctx_highlight(thread_ctx, name, index);
+}
 
-    printf("    \"message\": \"%s\"\n", current_message);
-    printf("  }");
+void log_node(int id, const char* label) {
+    if (thread_ctx != NULL) log_ctx_node(thread_ctx, id, label);
+}
+
+void log_edge(int from_id, int to_id) {
+    if (thread_ctx != NULL) log_ctx_edge(thread_ctx, from_id, to_id);
+}
+
+void log_step_end() {
+    if (thread_ctx != NULL) log_ctx_step_end(thread_ctx);
 }
 
 void log_finish() {
-    printf("\n]\n");
+    if (thread_ctx == NULL) return;
+    log_ctx_finish(thread_ctx);
+    if (thread_ctx_owned) {
+        log_ctx_destroy(thread_ctx);
+        thread_ctx = NULL;
+        thread_ctx_owned = 0;
+    }
+}
+
+static const char* const input_types[] = {"int", "int_args", "int_list", "tree", "string"};
+static const char* const costs[] = {"logarithmic", "linear", "linearithmic", "quadratic", "exponential"};
+
+static void describe_str(const char* s) {
+    putchar('"');
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\') putchar('\\');
+        putchar(*s);
+    }
+    putchar('"');
+}
+
+int log_describe(int argc, char* argv[], const LogDescription* description) {
+    if (argc != 2 || strcmp(argv[1], "--describe") != 0) return 0;
+
+    printf("{\"cost\": \"%s\", \"deterministic\": %s, \"inputs\": [", costs[description->cost],
+           description->nondeterministic ? "false" : "true");
+    for (int i = 0; i < description->input_count; i++) {
+        const LogInput* input = &description->inputs[i];
+        printf("%s{\"name\": ", i > 0 ? ", " : "");
+        describe_str(input->name);
+        printf(", \"type\": \"%s\"", input_types[input->type]);
+        if (input->min != 0 || input->max != 0) printf(", \"min\": %d, \"max\": %d", input->min, input->max);
+        if (input->max_size > 0) {
+            printf(", \"%s\": %d", input->type == LOG_INPUT_STRING ? "max_length" : "max_items", input->max_size);
+        }
+        if (input->charset != NULL) {
+            printf(", \"charset\": ");
+            describe_str(input->charset);
+        }
+        putchar('}');
+    }
+    printf("]}\n");
+    return 1;
 }
@@ -8,7 +8,22 @@
 // s = "abcabcbb"
 // Use an array map[128] to store frequency or last index
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    // ASCII only: map[] is indexed by character
+    {.name = "s",
+     .type = LOG_INPUT_STRING,
+     .max_size = 255,
+     .charset = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 "},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LINEAR,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(longest_substring) {
+    if (log_describe(argc, argv, &description)) return 0;
     log_init();
 
     char s[256] = "abcabcbb";
@@ -85,6 +100,7 @@ int main(int argc, char* argv[]) {
     log_message("Finished! Longest Substring Length Determined.");
     log_step_end();
 
+    log_result(&max_len, 1);
     log_finish();
     return 0;
 }
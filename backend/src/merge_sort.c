@@ -6,7 +6,7 @@
 // Merges two subarrays of arr[].
 // First subarray is arr[l..m]
 // Second subarray is arr[m+1..r]
-void merge(int arr[], int l, int m, int r, int n_total) {
+void merge(int arr[], int l, int m, int r) {
     int i, j, k;
     int n1 = m - l + 1;
     int n2 = r - m;
@@ -19,6 +19,8 @@ void merge(int arr[], int l, int m, int r, int n_total) {
         L[i] = arr[l + i];
     for (j = 0; j < n2; j++)
         R[j] = arr[m + 1 + j];
+    log_count_read(n1 + n2);
+    log_count_write(n1 + n2);
 
     /* Merge the temp arrays back into arr[l..r]*/
     i = 0; // Initial index of first subarray
@@ -26,19 +28,16 @@ void merge(int arr[], int l, int m, int r, int n_total) {
     k = l; // Initial index of merged subarray
     
     log_step_start();
-    log_array("Sort Array", arr, n_total);
-    char msg[128];
-    sprintf(msg, "Merging ranges [%d..%d] and [%d..%d]", l, m, m+1, r);
-    log_message(msg);
+    log_message_fmt(MSG_MERGE_RANGES, l, m, m+1, r);
     log_step_end();
 
     while (i < n1 && j < n2) {
         // Visual comparison
         log_step_start();
-        log_array("Sort Array", arr, n_total);
         log_highlight("Sort Array", k); // Target
-        sprintf(msg, "Comparing L:%d and R:%d for position %d", L[i], R[j], k);
-        log_message(msg);
+        log_message_fmt(MSG_MERGE_COMPARE, L[i], R[j], k);
+        log_count_compare(1);
+        log_count_read(2);
         log_step_end();
 
         if (L[i] <= R[j]) {
@@ -48,10 +47,10 @@ void merge(int arr[], int l, int m, int r, int n_total) {
             arr[k] = R[j];
             j++;
         }
+        log_count_write(1);
         
         // Show update
         log_step_start();
-        log_array("Sort Array", arr, n_total);
         log_highlight("Sort Array", k);
         log_message("Placed value");
         log_step_end();
@@ -64,10 +63,11 @@ void merge(int arr[], int l, int m, int r, int n_total) {
         arr[k] = L[i];
         i++;
         k++;
+        log_count_read(1);
+        log_count_write(1);
         
         // Visual update
         log_step_start();
-        log_array("Sort Array", arr, n_total);
         log_highlight("Sort Array", k-1);
         log_message("Copying remaining from Left");
         log_step_end();
@@ -78,10 +78,11 @@ void merge(int arr[], int l, int m, int r, int n_total) {
         arr[k] = R[j];
         j++;
         k++;
+        log_count_read(1);
+        log_count_write(1);
         
          // Visual update
         log_step_start();
-        log_array("Sort Array", arr, n_total);
         log_highlight("Sort Array", k-1);
         log_message("Copying remaining from Right");
         log_step_end();
@@ -90,25 +91,37 @@ void merge(int arr[], int l, int m, int r, int n_total) {
 
 /* l is for left index and r is right index of the
    sub-array of arr to be sorted */
-void mergeSort(int arr[], int l, int r, int n) {
+void mergeSort(int arr[], int l, int r) {
     if (l < r) {
         // Same as (l+r)/2, but avoids overflow for
         // large l and h
         int m = l + (r - l) / 2;
 
         // Sort first and second halves
-        mergeSort(arr, l, m, n);
-        mergeSort(arr, m + 1, r, n);
+        mergeSort(arr, l, m);
+        mergeSort(arr, m + 1, r);
 
-        merge(arr, l, m, r, n);
+        merge(arr, l, m, r);
     }
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "nums", .type = LOG_INPUT_INT_LIST, .max_size = 500},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LINEARITHMIC,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(merge_sort) {
+    if (log_describe(argc, argv, &description)) return 0;
     if (argc < 2) return 1;
 
     char* input = argv[1];
-    int arr[100];
+    // At most one value per argument, or per two characters of a list
+    int* arr = malloc((argc > 2 ? (size_t)argc - 1 : strlen(input) / 2 + 1) * sizeof(int));
     int n = 0;
 
     // Check if we have multiple arguments
@@ -125,20 +138,20 @@ int main(int argc, char* argv[]) {
     }
 
     log_init();
+    log_watch_array("Sort Array", arr, n);
     
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_message("Initial State");
     log_step_end();
     
-    mergeSort(arr, 0, n - 1, n);
+    mergeSort(arr, 0, n - 1);
     
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_message("Array Sorted!");
     log_step_end();
     
     log_finish();
+    free(arr);
 
     return 0;
 }
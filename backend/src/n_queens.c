@@ -7,8 +7,8 @@
 // 4x4 Board for defaults
 
 #define MAX_N 10
-int queens[MAX_N]; // queens[i] = col index for row i
-int N = 4;
+_Thread_local int queens[MAX_N]; // queens[i] = col index for row i
+_Thread_local int N = 4;
 
 int isSafe(int row, int col) {
     for (int i = 0; i < row; i++) {
@@ -19,7 +19,7 @@ int isSafe(int row, int col) {
     return 1;
 }
 
-int solutions = 0;
+_Thread_local int solutions = 0;
 
 void solve(int row) {
     if (row == N) {
@@ -60,7 +60,21 @@ void solve(int row) {
     }
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "n", .type = LOG_INPUT_INT, .min = 1, .max = 8},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_EXPONENTIAL,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(n_queens) {
+    if (log_describe(argc, argv, &description)) return 0;
+    // Defaults again, in case main() already ran in this thread
+    N = 4;
+    solutions = 0;
     log_init();
 
     if(argc > 1) N = atoi(argv[1]);
@@ -82,6 +96,7 @@ int main(int argc, char* argv[]) {
         log_step_end();
     }
 
+    log_result(queens, N);
     log_finish();
     return 0;
 }
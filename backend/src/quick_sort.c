@@ -7,28 +7,29 @@ void swap(int* a, int* b) {
     int t = *a;
     *a = *b;
     *b = t;
+    log_count_swap(1);
+    log_count_read(2);
+    log_count_write(2);
 }
 
-int partition(int arr[], int low, int high, int n) {
+int partition(int arr[], int low, int high) {
     int pivot = arr[high];    // pivot
     int i = (low - 1);  // Index of smaller element
+    log_count_read(1);
 
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_highlight("Sort Array", high); // Pivot
-    char msg[128];
-    sprintf(msg, "Partitioning range [%d..%d] using Pivot %d", low, high, pivot);
-    log_message(msg);
+    log_message_fmt(MSG_QUICK_PARTITION, low, high, pivot);
     log_step_end();
 
     for (int j = low; j <= high - 1; j++) {
         log_step_start();
-        log_array("Sort Array", arr, n);
         log_highlight("Sort Array", high); // Pivot
         log_highlight("Sort Array", j);    // Current
         log_highlight("Sort Array", i+1);  // Swap target
-        sprintf(msg, "Comparing %d with Pivot %d", arr[j], pivot);
-        log_message(msg);
+        log_message_fmt(MSG_QUICK_COMPARE, arr[j], pivot);
+        log_count_compare(1);
+        log_count_read(1);
         log_step_end();
 
         if (arr[j] < pivot) {
@@ -36,7 +37,6 @@ int partition(int arr[], int low, int high, int n) {
             swap(&arr[i], &arr[j]);
             
             log_step_start();
-            log_array("Sort Array", arr, n);
             log_highlight("Sort Array", i);
             log_highlight("Sort Array", j);
             log_message("Swapping smaller element to left");
@@ -46,7 +46,6 @@ int partition(int arr[], int low, int high, int n) {
     swap(&arr[i + 1], &arr[high]);
     
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_highlight("Sort Array", i+1);
     log_message("Placed Pivot in correct position");
     log_step_end();
@@ -54,24 +53,36 @@ int partition(int arr[], int low, int high, int n) {
     return (i + 1);
 }
 
-void quickSort(int arr[], int low, int high, int n) {
+void quickSort(int arr[], int low, int high) {
     if (low < high) {
         /* pi is partitioning index, arr[p] is now
            at right place */
-        int pi = partition(arr, low, high, n);
+        int pi = partition(arr, low, high);
 
         // Separately sort elements before
         // partition and after partition
-        quickSort(arr, low, pi - 1, n);
-        quickSort(arr, pi + 1, high, n);
+        quickSort(arr, low, pi - 1);
+        quickSort(arr, pi + 1, high);
     }
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "nums", .type = LOG_INPUT_INT_LIST, .max_size = 500},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LINEARITHMIC,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(quick_sort) {
+    if (log_describe(argc, argv, &description)) return 0;
     if (argc < 2) return 1;
 
     char* input = argv[1];
-    int arr[100];
+    // At most one value per argument, or per two characters of a list
+    int* arr = malloc((argc > 2 ? (size_t)argc - 1 : strlen(input) / 2 + 1) * sizeof(int));
     int n = 0;
 
     // Check for multiple arguments
@@ -88,20 +99,20 @@ int main(int argc, char* argv[]) {
     }
 
     log_init();
+    log_watch_array("Sort Array", arr, n);
     
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_message("Initial State");
     log_step_end();
 
-    quickSort(arr, 0, n - 1, n);
+    quickSort(arr, 0, n - 1);
     
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_message("Array Sorted!");
     log_step_end();
     
     log_finish();
+    free(arr);
 
     return 0;
 }
@@ -8,6 +8,8 @@ int getMax(int arr[], int n) {
     for (int i = 1; i < n; i++)
         if (arr[i] > mx)
             mx = arr[i];
+    log_count_compare(n - 1);
+    log_count_read(n);
     return mx;
 }
 
@@ -17,6 +19,7 @@ void countSort(int arr[], int n, int exp) {
 
     for (i = 0; i < n; i++)
         count[(arr[i] / exp) % 10]++;
+    log_count_read(n);
 
     for (i = 1; i < 10; i++)
         count[i] += count[i - 1];
@@ -25,16 +28,17 @@ void countSort(int arr[], int n, int exp) {
         output[count[(arr[i] / exp) % 10] - 1] = arr[i];
         count[(arr[i] / exp) % 10]--;
     }
+    log_count_read(n);
+    log_count_write(n);
 
     for (i = 0; i < n; i++) {
         arr[i] = output[i];
+        log_count_read(1);
+        log_count_write(1);
         
         log_step_start();
-        log_array("Sort Array", arr, n);
         log_highlight("Sort Array", i);
-        char msg[128];
-        sprintf(msg, "Sorted by digit at exp %d", exp);
-        log_message(msg);
+        log_message_fmt(MSG_RADIX_DIGIT, exp);
         log_step_end();
     }
 }
@@ -43,7 +47,6 @@ void radixSort(int arr[], int n) {
     int m = getMax(arr, n);
 
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_message("Initial State");
     log_step_end();
 
@@ -52,11 +55,23 @@ void radixSort(int arr[], int n) {
     }
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "nums", .type = LOG_INPUT_INT_LIST, .min = 0, .max = 999999999, .max_size = 500},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LINEAR,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(radix_sort) {
+    if (log_describe(argc, argv, &description)) return 0;
     if (argc < 2) return 1;
 
     char* input = argv[1];
-    int arr[100];
+    // At most one value per argument, or per two characters of a list
+    int* arr = malloc((argc > 2 ? (size_t)argc - 1 : strlen(input) / 2 + 1) * sizeof(int));
     int n = 0;
 
     if (argc > 2) {
@@ -72,8 +87,10 @@ int main(int argc, char* argv[]) {
     }
 
     log_init();
+    log_watch_array("Sort Array", arr, n);
     radixSort(arr, n);
     log_finish();
+    free(arr);
 
     return 0;
 }
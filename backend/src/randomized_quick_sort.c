@@ -8,25 +8,27 @@ void swap(int* a, int* b) {
     int t = *a;
     *a = *b;
     *b = t;
+    log_count_swap(1);
+    log_count_read(2);
+    log_count_write(2);
 }
 
-int partition(int arr[], int low, int high, int n) {
+int partition(int arr[], int low, int high) {
     int pivot = arr[high];    // pivot
     int i = (low - 1);  // Index of smaller element
+    log_count_read(1);
 
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_highlight("Sort Array", high); // Pivot
-    char msg[128];
-    sprintf(msg, "Partitioning with Pivot %d", pivot);
-    log_message(msg);
+    log_message_fmt(MSG_RQUICK_PARTITION, pivot);
     log_step_end();
 
     for (int j = low; j <= high - 1; j++) {
         log_step_start();
-        log_array("Sort Array", arr, n);
         log_highlight("Sort Array", j);
         log_highlight("Sort Array", high);
+        log_count_compare(1);
+        log_count_read(1);
         log_step_end();
         
         if (arr[j] < pivot) {
@@ -38,35 +40,46 @@ int partition(int arr[], int low, int high, int n) {
     return (i + 1);
 }
 
-int partition_r(int arr[], int low, int high, int n) {
-    srand(time(NULL));
+int partition_r(int arr[], int low, int high) {
     int random = low + rand() % (high - low + 1); // +1 to include high
     
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_highlight("Sort Array", random);
     log_message("Chose Random Pivot");
     log_step_end();
     
     swap(&arr[random], &arr[high]);
 
-    return partition(arr, low, high, n);
+    return partition(arr, low, high);
 }
 
-void quickSort(int arr[], int low, int high, int n) {
+void quickSort(int arr[], int low, int high) {
     if (low < high) {
-        int pi = partition_r(arr, low, high, n);
+        int pi = partition_r(arr, low, high);
 
-        quickSort(arr, low, pi - 1, n);
-        quickSort(arr, pi + 1, high, n);
+        quickSort(arr, low, pi - 1);
+        quickSort(arr, pi + 1, high);
     }
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "nums", .type = LOG_INPUT_INT_LIST, .max_size = 500},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LINEARITHMIC,
+    .nondeterministic = 1,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(randomized_quick_sort) {
+    if (log_describe(argc, argv, &description)) return 0;
     if (argc < 2) return 1;
 
     char* input = argv[1];
-    int arr[100];
+    // At most one value per argument, or per two characters of a list
+    int* arr = malloc((argc > 2 ? (size_t)argc - 1 : strlen(input) / 2 + 1) * sizeof(int));
     int n = 0;
 
     // Check for multiple arguments
@@ -83,20 +96,21 @@ int main(int argc, char* argv[]) {
     }
 
     log_init();
+    log_watch_array("Sort Array", arr, n);
     
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_message("Initial State");
     log_step_end();
 
-    quickSort(arr, 0, n - 1, n);
+    srand(time(NULL));
+    quickSort(arr, 0, n - 1);
     
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_message("Array Sorted!");
     log_step_end();
     
     log_finish();
+    free(arr);
 
     return 0;
 }
@@ -2,7 +2,7 @@
 #include <stdlib.h>
 #include "../include/logger.h"
 
-int node_id_counter = 0;
+_Thread_local int node_id_counter = 0;
 
 int fib(int n, int parent_id) {
     int current_id = node_id_counter++;
@@ -47,12 +47,30 @@ int fib(int n, int parent_id) {
     return res;
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    // Every call stays in the tree. Full (non-delta) steps each repeat the
+    // tree so far, so past n = 12 a full trace goes over /run's 16MB limit;
+    // the frontend plays stored LOG_DELTA=1 traces, where each node is
+    // written once (fib(25): ~25MB at 100000 steps).
+    {.name = "n", .type = LOG_INPUT_INT, .min = 0, .max = 25},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_EXPONENTIAL,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(recursion_fib) {
+    if (log_describe(argc, argv, &description)) return 0;
+    // Node ids restart for every trace
+    node_id_counter = 0;
     if (argc < 2) return 1;
     int n = atoi(argv[1]);
 
     log_init();
-    fib(n, -1);
+    int result = fib(n, -1);
+    log_result(&result, 1);
     log_finish();
     return 0;
 }
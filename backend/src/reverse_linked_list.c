@@ -16,7 +16,18 @@
 // Prev = Curr
 // Curr = Next
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "values", .type = LOG_INPUT_INT_ARGS, .max_size = 100},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LINEAR,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(reverse_linked_list) {
+    if (log_describe(argc, argv, &description)) return 0;
     log_init();
 
     int values[100];
@@ -91,6 +102,7 @@ int main(int argc, char* argv[]) {
     log_message("List Reversed! New Head is at the end.");
     log_step_end();
 
+    log_result(next_ptrs, n);
     log_finish();
     return 0;
 }
@@ -7,6 +7,9 @@ void swap(int* a, int* b) {
     int t = *a;
     *a = *b;
     *b = t;
+    log_count_swap(1);
+    log_count_read(2);
+    log_count_write(2);
 }
 
 void selectionSort(int arr[], int n) {
@@ -14,7 +17,6 @@ void selectionSort(int arr[], int n) {
 
     // Log initial state
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_message("Initial State");
     log_step_end();
 
@@ -22,30 +24,26 @@ void selectionSort(int arr[], int n) {
         min_idx = i;
         
         log_step_start();
-        log_array("Sort Array", arr, n);
         log_highlight("Sort Array", i); // Current position
         log_highlight("Sort Array", min_idx); // Current min
-        char msg[128];
-        sprintf(msg, "Searching for minimum starting from index %d", i);
-        log_message(msg);
+        log_message_fmt(MSG_SELECTION_SEARCH, i);
         log_step_end();
 
         for (j = i + 1; j < n; j++) {
             log_step_start();
-            log_array("Sort Array", arr, n);
             log_highlight("Sort Array", i);
             log_highlight("Sort Array", min_idx);
             log_highlight("Sort Array", j); // Current compare
             
-            sprintf(msg, "Comparing %d with current min %d", arr[j], arr[min_idx]);
-            log_message(msg);
+            log_message_fmt(MSG_SELECTION_COMPARE, arr[j], arr[min_idx]);
+            log_count_compare(1);
+            log_count_read(2);
             log_step_end();
 
             if (arr[j] < arr[min_idx]) {
                 min_idx = j;
                 
                 log_step_start();
-                log_array("Sort Array", arr, n);
                 log_highlight("Sort Array", i);
                 log_highlight("Sort Array", min_idx); // New min
                 log_message("Found new minimum!");
@@ -57,27 +55,36 @@ void selectionSort(int arr[], int n) {
             swap(&arr[min_idx], &arr[i]);
             
             log_step_start();
-            log_array("Sort Array", arr, n);
             log_highlight("Sort Array", i);
             log_highlight("Sort Array", min_idx);
-            sprintf(msg, "Swapped %d and %d", arr[i], arr[min_idx]);
-            log_message(msg);
+            log_message_fmt(MSG_SELECTION_SWAP, arr[i], arr[min_idx]);
             log_step_end();
         }
     }
     
     log_step_start();
-    log_array("Sort Array", arr, n);
     log_message("Array Sorted!");
     log_step_end();
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "nums", .type = LOG_INPUT_INT_LIST, .max_size = 500},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_QUADRATIC,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(selection_sort) {
+    if (log_describe(argc, argv, &description)) return 0;
     if (argc < 2) return 1;
 
     // Parse input: "1,2,3" -> int array
     char* input = argv[1];
-    int arr[100];
+    // At most one value per argument, or per two characters of a list
+    int* arr = malloc((argc > 2 ? (size_t)argc - 1 : strlen(input) / 2 + 1) * sizeof(int));
     int n = 0;
 
     // Check if we have multiple arguments (e.g. "64" "25" "12") or single string
@@ -96,8 +103,10 @@ int main(int argc, char* argv[]) {
     }
 
     log_init();
+    log_watch_array("Sort Array", arr, n);
     selectionSort(arr, n);
     log_finish();
+    free(arr);
 
     return 0;
 }
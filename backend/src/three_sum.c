@@ -24,7 +24,18 @@ void sort_and_log(int* nums, int n) {
     log_step_end();
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "nums", .type = LOG_INPUT_INT_LIST, .max_size = 100},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_QUADRATIC,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(three_sum) {
+    if (log_describe(argc, argv, &description)) return 0;
     log_init();
 
     int nums[100];
@@ -110,6 +121,7 @@ int main(int argc, char* argv[]) {
         log_step_end();
     }
 
+    log_result(&found, 1);
     log_finish();
     return 0;
 }
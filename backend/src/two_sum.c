@@ -2,7 +2,19 @@
 #include <stdlib.h>
 #include "../include/logger.h"
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "target", .type = LOG_INPUT_INT},
+    {.name = "nums", .type = LOG_INPUT_INT_ARGS, .max_size = 100},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_QUADRATIC,
+    .inputs = inputs,
+    .input_count = 2,
+};
+
+int ALGORITHM_MAIN(two_sum) {
+    if (log_describe(argc, argv, &description)) return 0;
     log_init();
 
     int nums[100]; // Increased max size
@@ -50,6 +62,8 @@ int main(int argc, char* argv[]) {
                  log_message("Found match!");
                  log_step_end();
                  
+                 int pair[2] = {i, j};
+                 log_result(pair, 2);
                  log_finish();
                  return 0;
             }
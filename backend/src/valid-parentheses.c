@@ -6,8 +6,8 @@
 #define MAX_SIZE 100
 
 // Stack implementation for visualization
-char stack[MAX_SIZE];
-int top = -1;
+_Thread_local char stack[MAX_SIZE];
+_Thread_local int top = -1;
 
 void push(char c) {
     if (top < MAX_SIZE - 1) {
@@ -66,7 +66,20 @@ void log_state(const char* s, int current_index, const char* message) {
     log_step_end();
 }
 
-int main(int argc, char* argv[]) {
+static const LogInput inputs[] = {
+    {.name = "s", .type = LOG_INPUT_STRING, .max_size = MAX_SIZE - 1, .charset = "()[]{}"},
+};
+
+static const LogDescription description = {
+    .cost = LOG_COST_LINEAR,
+    .inputs = inputs,
+    .input_count = 1,
+};
+
+int ALGORITHM_MAIN(valid_parentheses) {
+    if (log_describe(argc, argv, &description)) return 0;
+    // Empty stack
+    top = -1;
     log_init();
 
     char s[MAX_SIZE] = "()[]{}"; // Default
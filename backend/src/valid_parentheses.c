@@ -72,7 +72,7 @@ void log_state(const char* input, int current_idx, Stack* s, const char* msg) {
     log_step_end();
 }
 
-int main(int argc, char* argv[]) {
+int ALGORITHM_MAIN(valid_parentheses) {
     char s[MAX_STACK] = "()[]{}";
     if (argc > 1) {
         strncpy(s, argv[1], MAX_STACK - 1);
@@ -0,0 +1,76 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "multicall.h"
+
+// algoviz: every algorithm in one binary, busybox-style.
+// Usage: algoviz <algorithm> [arguments]   runs the algorithm
+//        <algorithm> [arguments]           the same, through a link to
+//                                          algoviz named after it
+//        algoviz --list                    prints the algorithms
+//        algoviz --install DIR             creates those links in DIR
+// A run is the same as running build/<algorithm>: same arguments, same
+// LOG_* environment, same trace. One binary means one copy of the logger
+// and of the code the programs share in the page cache, however many
+// different algorithms run.
+
+static const char* base_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static int usage() {
+    fprintf(stderr, "usage: algoviz <algorithm> [arguments]\n"
+                    "       algoviz --list\n"
+                    "       algoviz --install DIR\n");
+    return 1;
+}
+
+// Links DIR/<algorithm> to this binary for every algorithm.
+static int install(const char* dir) {
+    char self[4096];
+    ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (len < 0) {
+        perror("algoviz: /proc/self/exe");
+        return 1;
+    }
+    self[len] = '\0';
+    for (size_t i = 0; i < algorithm_count; i++) {
+        char link[4096];
+        snprintf(link, sizeof(link), "%s/%s", dir, algorithms[i].name);
+        if (unlink(link) != 0 && errno != ENOENT) {
+            fprintf(stderr, "algoviz: %s: %s\n", link, strerror(errno));
+            return 1;
+        }
+        if (symlink(self, link) != 0) {
+            fprintf(stderr, "algoviz: %s: %s\n", link, strerror(errno));
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Called through a link: argv[0] names the algorithm
+    AlgorithmMain entry = find_algorithm(base_name(argv[0]));
+    if (entry) return entry(argc, argv);
+
+    if (argc < 2) return usage();
+    if (strcmp(argv[1], "--list") == 0) {
+        for (size_t i = 0; i < algorithm_count; i++) puts(algorithms[i].name);
+        return 0;
+    }
+    if (strcmp(argv[1], "--install") == 0) {
+        return argc == 3 ? install(argv[2]) : usage();
+    }
+    entry = find_algorithm(argv[1]);
+    if (!entry) {
+        fprintf(stderr, "algoviz: unknown algorithm '%s' (see algoviz --list)\n", argv[1]);
+        return 1;
+    }
+    // The algorithm sees itself as argv[0], as when run on its own
+    return entry(argc - 1, argv + 1);
+}
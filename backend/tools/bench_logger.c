@@ -0,0 +1,283 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "logger.h"
+
+// bench_logger: measures trace serialization throughput.
+// Usage: bench_logger [--max-steps N] [--threads T] [n]
+//   Runs the logging pattern of merge_sort and bubble_sort on n random
+//   values (default 10000) in a child process whose stdout is a pipe, the
+//   same way server.js runs the algorithms, and reports bytes/sec and
+//   ns/step. Runs stop after --max-steps steps (default 20000) because
+//   bubble sort at n=10k would otherwise log ~10^8 steps. LOG_FORMAT,
+//   LOG_DELTA etc. are honored as usual.
+//
+//   With --threads T, T threads each write whole merge_sort traces through
+//   their own logger context into a byte-counting sink, in one process, and
+//   the aggregate throughput is reported.
+
+static long max_steps = 20000;
+static long* steps_done;
+
+// Threaded runs count steps per thread and are not capped.
+static _Thread_local long thread_steps;
+static _Thread_local int threaded;
+
+static void step_begin() {
+    if (threaded) {
+        thread_steps++;
+        log_step_start();
+        return;
+    }
+    if (*steps_done == max_steps) {
+        log_finish();
+        exit(0);
+    }
+    (*steps_done)++;
+    log_step_start();
+}
+
+// Same calls as src/merge_sort.c
+static void merge(int arr[], int l, int m, int r) {
+    int n1 = m - l + 1;
+    int n2 = r - m;
+    int* L = malloc(n1 * sizeof(int));
+    int* R = malloc(n2 * sizeof(int));
+    int i, j, k;
+
+    for (i = 0; i < n1; i++) L[i] = arr[l + i];
+    for (j = 0; j < n2; j++) R[j] = arr[m + 1 + j];
+    log_count_read(n1 + n2);
+    log_count_write(n1 + n2);
+    i = 0;
+    j = 0;
+    k = l;
+
+    step_begin();
+    log_message_fmt(MSG_MERGE_RANGES, l, m, m + 1, r);
+    log_step_end();
+
+    while (i < n1 && j < n2) {
+        step_begin();
+        log_highlight("Sort Array", k);
+        log_message_fmt(MSG_MERGE_COMPARE, L[i], R[j], k);
+        log_count_compare(1);
+        log_count_read(2);
+        log_step_end();
+
+        arr[k++] = (L[i] <= R[j]) ? L[i++] : R[j++];
+        log_count_write(1);
+
+        step_begin();
+        log_highlight("Sort Array", k - 1);
+        log_message("Placed value");
+        log_step_end();
+    }
+    while (i < n1) {
+        arr[k++] = L[i++];
+        log_count_read(1);
+        log_count_write(1);
+        step_begin();
+        log_highlight("Sort Array", k - 1);
+        log_message("Copying remaining from Left");
+        log_step_end();
+    }
+    while (j < n2) {
+        arr[k++] = R[j++];
+        log_count_read(1);
+        log_count_write(1);
+        step_begin();
+        log_highlight("Sort Array", k - 1);
+        log_message("Copying remaining from Right");
+        log_step_end();
+    }
+    free(L);
+    free(R);
+}
+
+static void merge_sort(int arr[], int l, int r) {
+    if (l < r) {
+        int m = l + (r - l) / 2;
+        merge_sort(arr, l, m);
+        merge_sort(arr, m + 1, r);
+        merge(arr, l, m, r);
+    }
+}
+
+static void run_merge_sort(int* arr, int n) {
+    merge_sort(arr, 0, n - 1);
+}
+
+// Same calls as src/bubble_sort.c
+static void run_bubble_sort(int* nums, int n) {
+    for (int i = 0; i < n - 1; i++) {
+        for (int j = 0; j < n - i - 1; j++) {
+            step_begin();
+            log_highlight("Sort Array", j);
+            log_highlight("Sort Array", j + 1);
+            log_message_fmt(MSG_BUBBLE_COMPARE, nums[j], nums[j + 1]);
+            log_count_compare(1);
+            log_count_read(2);
+            log_step_end();
+
+            if (nums[j] > nums[j + 1]) {
+                int t = nums[j];
+                nums[j] = nums[j + 1];
+                nums[j + 1] = t;
+                log_count_swap(1);
+                log_count_read(2);
+                log_count_write(2);
+
+                step_begin();
+                log_highlight("Sort Array", j);
+                log_highlight("Sort Array", j + 1);
+                log_message_fmt(MSG_BUBBLE_SWAP, nums[j + 1], nums[j]);
+                log_step_end();
+            }
+        }
+    }
+}
+
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(const char* name, void (*run)(int*, int), int n) {
+    int fds[2];
+    if (pipe(fds) < 0) {
+        perror("pipe");
+        exit(1);
+    }
+
+    *steps_done = 0;
+    double start = now_sec();
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        dup2(fds[1], STDOUT_FILENO);
+        close(fds[1]);
+
+        int* arr = malloc(n * sizeof(int));
+        srand(42);
+        for (int i = 0; i < n; i++) arr[i] = rand() % 1000;
+
+        log_init();
+        log_watch_array("Sort Array", arr, n);
+        run(arr, n);
+        log_finish();
+        exit(0);
+    }
+    close(fds[1]);
+
+    static char buf[1 << 16];
+    long long bytes = 0;
+    ssize_t got;
+    while ((got = read(fds[0], buf, sizeof(buf))) > 0) bytes += got;
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    double elapsed = now_sec() - start;
+
+    printf("%-12s n=%-7d steps=%-8ld bytes=%-11lld %8.1f ns/step %9.1f MB/s\n", name, n,
+           *steps_done, bytes, elapsed * 1e9 / *steps_done, bytes / elapsed / 1e6);
+}
+
+typedef struct {
+    int n;
+    long steps;
+    long long bytes;
+} ThreadRun;
+
+static void count_bytes(void* user, const void* data, size_t len) {
+    (void)data;
+    ((ThreadRun*)user)->bytes += len;
+}
+
+static void* thread_main(void* arg) {
+    ThreadRun* run = arg;
+    LogOptions options;
+    log_options_from_env(&options);
+    LogCtx* ctx = log_ctx_create(&options, count_bytes, run);
+    log_bind_ctx(ctx);
+    threaded = 1;
+
+    int* arr = malloc(run->n * sizeof(int));
+    unsigned seed = 42;
+    for (int i = 0; i < run->n; i++) arr[i] = rand_r(&seed) % 1000;
+
+    log_init();
+    log_watch_array("Sort Array", arr, run->n);
+    run_merge_sort(arr, run->n);
+    log_finish();
+
+    run->steps = thread_steps;
+    log_bind_ctx(NULL);
+    log_ctx_destroy(ctx);
+    free(arr);
+    return NULL;
+}
+
+static void bench_threads(int threads, int n) {
+    pthread_t* ids = malloc(threads * sizeof(pthread_t));
+    ThreadRun* runs = calloc(threads, sizeof(ThreadRun));
+
+    double start = now_sec();
+    for (int t = 0; t < threads; t++) {
+        runs[t].n = n;
+        pthread_create(&ids[t], NULL, thread_main, &runs[t]);
+    }
+    long steps = 0;
+    long long bytes = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+        steps += runs[t].steps;
+        bytes += runs[t].bytes;
+        // Same input in every thread, so the traces must match in size.
+        if (runs[t].bytes != runs[0].bytes) {
+            fprintf(stderr, "thread %d wrote %lld bytes, thread 0 %lld\n", t, runs[t].bytes, runs[0].bytes);
+            exit(1);
+        }
+    }
+    double elapsed = now_sec() - start;
+
+    printf("merge_sort   n=%-7d threads=%-3d steps=%-9ld bytes=%-11lld %8.1f ns/step %9.1f MB/s\n", n,
+           threads, steps, bytes, elapsed * 1e9 / steps, bytes / elapsed / 1e6);
+    free(ids);
+    free(runs);
+}
+
+int main(int argc, char* argv[]) {
+    int n = 10000;
+    int threads = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--max-steps") == 0 && i + 1 < argc) {
+            max_steps = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else {
+            n = atoi(argv[i]);
+        }
+    }
+
+    if (threads > 0) {
+        bench_threads(threads, n);
+        return 0;
+    }
+
+    steps_done = mmap(NULL, sizeof(long), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (steps_done == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+
+    bench("merge_sort", run_merge_sort, n);
+    bench("bubble_sort", run_bubble_sort, n);
+    return 0;
+}
@@ -0,0 +1,313 @@
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "logger.h"
+
+// bench_sort: times the sorting kernels of src/*_sort.c without logging.
+// Usage: bench_sort [--seed S] [--max-n N] [--max-seconds T] [sort ...]
+//   Every sort (default: all of them) runs on every input distribution at
+//   n = 10^3, 10^4, ... up to --max-n (default 10^7), each case in its own
+//   process, and one CSV row per case goes to stdout:
+//     sort,distribution,n,seed,ns_per_element,comparisons,peak_rss_kb
+//   ns_per_element is the best of a few timed runs of the LOG_LEVEL 0 kernel
+//   (runs are repeated until they add up to 50ms); comparisons come from a
+//   separate run of the same kernel built with LOG_COUNT_OPS, so counting
+//   doesn't slow the timed runs down. peak_rss_kb is the case's process peak,
+//   the n input values included.
+//
+//   Inputs are values in [0, n) and depend only on --seed (default 42), the
+//   distribution and n: every sort gets the same arrays, and runs with the
+//   same seed can be compared. randomized_quick_sort draws its pivots from
+//   rand() seeded with the same seed.
+//
+//   A size is skipped, with a note on stderr, when the growth measured so far
+//   predicts a timed run longer than --max-seconds (default 5): the quadratic
+//   sorts, and quick_sort on its worst cases, stop around 10^5.
+
+// The kernels, renamed by the Makefile from each program's own sort function
+// (SORT_KERNEL_<sort>). The _ops builds count operations into log_ops.
+#define SORT_KERNEL(name, ...) \
+    void name##_kernel(__VA_ARGS__); \
+    void name##_kernel_ops(__VA_ARGS__);
+SORT_KERNEL(bubble_sort, int arr[], int n)
+SORT_KERNEL(selection_sort, int arr[], int n)
+SORT_KERNEL(insertion_sort, int arr[], int n)
+SORT_KERNEL(merge_sort, int arr[], int l, int r)
+SORT_KERNEL(quick_sort, int arr[], int low, int high)
+SORT_KERNEL(randomized_quick_sort, int arr[], int low, int high)
+SORT_KERNEL(counting_sort, int arr[], int n)
+SORT_KERNEL(radix_sort, int arr[], int n)
+
+_Thread_local LogOps log_ops;
+
+static void run_merge_sort(int arr[], int n) {
+    merge_sort_kernel(arr, 0, n - 1);
+}
+static void run_merge_sort_ops(int arr[], int n) {
+    merge_sort_kernel_ops(arr, 0, n - 1);
+}
+static void run_quick_sort(int arr[], int n) {
+    quick_sort_kernel(arr, 0, n - 1);
+}
+static void run_quick_sort_ops(int arr[], int n) {
+    quick_sort_kernel_ops(arr, 0, n - 1);
+}
+static void run_randomized_quick_sort(int arr[], int n) {
+    randomized_quick_sort_kernel(arr, 0, n - 1);
+}
+static void run_randomized_quick_sort_ops(int arr[], int n) {
+    randomized_quick_sort_kernel_ops(arr, 0, n - 1);
+}
+
+typedef struct {
+    const char* name;
+    void (*run)(int arr[], int n);
+    void (*run_ops)(int arr[], int n);
+} Sort;
+
+static const Sort sorts[] = {
+    {"bubble_sort", bubble_sort_kernel, bubble_sort_kernel_ops},
+    {"selection_sort", selection_sort_kernel, selection_sort_kernel_ops},
+    {"insertion_sort", insertion_sort_kernel, insertion_sort_kernel_ops},
+    {"merge_sort", run_merge_sort, run_merge_sort_ops},
+    {"quick_sort", run_quick_sort, run_quick_sort_ops},
+    {"randomized_quick_sort", run_randomized_quick_sort, run_randomized_quick_sort_ops},
+    {"counting_sort", counting_sort_kernel, counting_sort_kernel_ops},
+    {"radix_sort", radix_sort_kernel, radix_sort_kernel_ops},
+};
+#define SORT_COUNT (int)(sizeof(sorts) / sizeof(sorts[0]))
+
+static const char* distributions[] = {"random", "sorted", "reverse", "few_unique", "organ_pipe", "zipf"};
+#define DISTRIBUTION_COUNT (int)(sizeof(distributions) / sizeof(distributions[0]))
+
+#define FEW_UNIQUE 16        // distinct values of few_unique
+#define MIN_TIMED_SEC 0.05   // timed runs repeat until they add up to this
+#define MAX_TIMED_RUNS 1000
+
+// splitmix64: seedable, and each (seed, distribution, n) gets its own stream
+static uint64_t next_random(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static double next_unit(uint64_t* state) {
+    return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void generate(int* arr, int n, int distribution, uint64_t seed) {
+    uint64_t state = seed ^ ((uint64_t)distribution << 40) ^ (uint64_t)n;
+    for (int i = 0; i < n; i++) {
+        switch (distribution) {
+        case 0: arr[i] = (int)(next_random(&state) % n); break;
+        case 1: arr[i] = i; break;
+        case 2: arr[i] = n - 1 - i; break;
+        case 3: arr[i] = (int)(next_random(&state) % FEW_UNIQUE); break;
+        case 4: arr[i] = i < n - 1 - i ? i : n - 1 - i; break;
+        default: {
+            // Zipf with exponent 1 (continuous approximation): P(v) ~ 1/(v+1),
+            // so small values repeat a lot and large ones are rare
+            int v = (int)exp(next_unit(&state) * log((double)n)) - 1;
+            arr[i] = v < 0 ? 0 : v >= n ? n - 1 : v;
+        }
+        }
+    }
+}
+
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef struct {
+    void (*sort)(int arr[], int n);
+    int* arr;
+    int n;
+    double seconds;
+    long long comparisons;
+} SortRun;
+
+static void* sort_thread(void* arg) {
+    SortRun* run = arg;
+    log_ops = (LogOps){0};
+    double start = now_sec();
+    run->sort(run->arr, run->n);
+    run->seconds = now_sec() - start;
+    run->comparisons = log_ops.comparisons;
+    return NULL;
+}
+
+// merge_sort and radix_sort keep O(n) temporaries in VLAs and quick_sort
+// recurses n deep on its worst cases, so the kernels run on a thread whose
+// stack grows with n (untouched pages cost nothing).
+static void run_sort(SortRun* run) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, ((size_t)256 << 20) + (size_t)run->n * 16);
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, sort_thread, run) != 0) {
+        perror("pthread_create");
+        exit(1);
+    }
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attr);
+}
+
+typedef struct {
+    double seconds; // best timed run
+    long long comparisons;
+    long peak_rss_kb;
+    int sorted;
+} CaseResult;
+
+static int is_sorted(const int* arr, int n, long long sum) {
+    for (int i = 0; i < n; i++) {
+        sum -= arr[i];
+        if (i > 0 && arr[i - 1] > arr[i]) return 0;
+    }
+    return sum == 0;
+}
+
+static CaseResult run_case(const Sort* sort, int distribution, int n, uint64_t seed) {
+    CaseResult result = {.seconds = 1e30, .sorted = 1};
+    int* arr = malloc((size_t)n * sizeof(int));
+    long long sum = 0;
+    generate(arr, n, distribution, seed);
+    for (int i = 0; i < n; i++) sum += arr[i];
+
+    double total = 0;
+    for (int runs = 0; runs < MAX_TIMED_RUNS && total < MIN_TIMED_SEC; runs++) {
+        if (runs > 0) generate(arr, n, distribution, seed);
+        srand((unsigned)seed);
+        SortRun run = {.sort = sort->run, .arr = arr, .n = n};
+        run_sort(&run);
+        result.sorted &= is_sorted(arr, n, sum);
+        if (run.seconds < result.seconds) result.seconds = run.seconds;
+        total += run.seconds;
+    }
+
+    generate(arr, n, distribution, seed);
+    srand((unsigned)seed);
+    SortRun counted = {.sort = sort->run_ops, .arr = arr, .n = n};
+    run_sort(&counted);
+    result.sorted &= is_sorted(arr, n, sum);
+    result.comparisons = counted.comparisons;
+    free(arr);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    result.peak_rss_kb = usage.ru_maxrss;
+    return result;
+}
+
+// Runs the case in a child process, so its peak RSS is its own and a crash
+// (e.g. stack overflow) only loses that case. Returns 0 on failure.
+static int bench_case(const Sort* sort, int distribution, int n, uint64_t seed, double max_seconds,
+                      CaseResult* result) {
+    int fds[2];
+    if (pipe(fds) < 0) {
+        perror("pipe");
+        exit(1);
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        // A prediction can be off (e.g. quick_sort turning quadratic); cap
+        // the case well above the budget rather than hang
+        alarm((unsigned)(max_seconds * 20) + 10);
+        CaseResult own = run_case(sort, distribution, n, seed);
+        ssize_t written = write(fds[1], &own, sizeof(own));
+        _exit(written == (ssize_t)sizeof(own) ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t got = read(fds[0], result, sizeof(*result));
+    close(fds[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    if (got != (ssize_t)sizeof(*result) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        if (WIFSIGNALED(status)) {
+            fprintf(stderr, "bench_sort: %s %s n=%d: killed by signal %d (%s)\n", sort->name,
+                    distributions[distribution], n, WTERMSIG(status), strsignal(WTERMSIG(status)));
+        } else {
+            fprintf(stderr, "bench_sort: %s %s n=%d: failed\n", sort->name, distributions[distribution], n);
+        }
+        return 0;
+    }
+    if (!result->sorted) {
+        fprintf(stderr, "bench_sort: %s %s n=%d: output is not sorted\n", sort->name,
+                distributions[distribution], n);
+        return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t seed = 42;
+    long max_n = 10000000;
+    double max_seconds = 5;
+    int selected[SORT_COUNT];
+    int any_selected = 0;
+    memset(selected, 0, sizeof(selected));
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--max-n") == 0 && i + 1 < argc) {
+            max_n = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--max-seconds") == 0 && i + 1 < argc) {
+            max_seconds = atof(argv[++i]);
+        } else {
+            int found = 0;
+            for (int s = 0; s < SORT_COUNT; s++) {
+                if (strcmp(argv[i], sorts[s].name) == 0) selected[s] = found = any_selected = 1;
+            }
+            if (!found) {
+                fprintf(stderr, "bench_sort: unknown sort or option '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+    }
+    if (max_n > 0x7fffffff) max_n = 0x7fffffff;
+
+    printf("sort,distribution,n,seed,ns_per_element,comparisons,peak_rss_kb\n");
+    for (int s = 0; s < SORT_COUNT; s++) {
+        if (any_selected && !selected[s]) continue;
+        for (int d = 0; d < DISTRIBUTION_COUNT; d++) {
+            // Seconds of the two previous sizes, to predict the next one
+            double previous = 0, last = 0;
+            for (long n = 1000; n <= max_n; n *= 10) {
+                if (last > 0) {
+                    // Growth per 10x so far, between linear and quadratic
+                    double growth = previous > 0 ? last / previous : 100;
+                    growth = growth < 10 ? 10 : growth > 100 ? 100 : growth;
+                    if (last * growth > max_seconds) {
+                        fprintf(stderr, "bench_sort: %s %s: skipping n>=%ld (~%.0fs predicted, --max-seconds %g)\n",
+                                sorts[s].name, distributions[d], n, last * growth, max_seconds);
+                        break;
+                    }
+                }
+                CaseResult result;
+                if (!bench_case(&sorts[s], d, (int)n, seed, max_seconds, &result)) break;
+                printf("%s,%s,%ld,%llu,%.2f,%lld,%ld\n", sorts[s].name, distributions[d], n,
+                       (unsigned long long)seed, result.seconds * 1e9 / n, result.comparisons,
+                       result.peak_rss_kb);
+                fflush(stdout);
+                previous = last;
+                last = result.seconds;
+            }
+        }
+    }
+    return 0;
+}
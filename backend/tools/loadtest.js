@@ -0,0 +1,278 @@
+#!/usr/bin/env node
+// loadtest: replays a mix of the frontend's problems against POST /run and
+// writes throughput and latency percentiles to a JSON file, to compare
+// server versions.
+// Usage: node tools/loadtest.js [--option=value ...]
+//   --url=URL           server (default http://localhost:3001)
+//   --mix=a=W,b=W       algorithms and their weights (default: every problem
+//                       in frontend/src/data/problems.js, weight 1)
+//   --sizes=default,N   input sizes to pick from: "default" sends the
+//                       problem's default inputs; N generates N random list
+//                       values (or an N-character string) within the limits
+//                       the server reports at GET /algorithms
+//   --concurrency=C     closed loop: C requests outstanding at all times
+//                       (default 8)
+//   --rate=R            open loop instead: R requests per second, on a fixed
+//                       schedule; latency counts from the scheduled time, so
+//                       a slow server is not hidden by requests sent late
+//   --max-in-flight=M   open loop: requests due while M are outstanding are
+//                       dropped and counted (default 1000)
+//   --duration=S        run for S seconds (default 10), or
+//   --requests=N        send N requests
+//   --warmup=S          seconds of load before measuring (default 0)
+//   --seed=N            seed of the mix and the generated inputs (default 1)
+//   --out=FILE          report file (default loadtest.json)
+// The same seed and options send the same sequence of requests.
+
+const fs = require('fs');
+const path = require('path');
+const { performance } = require('perf_hooks');
+const { pathToFileURL } = require('url');
+
+const PROBLEMS_FILE = path.join(__dirname, '..', '..', 'frontend', 'src', 'data', 'problems.js');
+const MAX_INPUTS = 100; // arguments per request, as server.js allows
+
+function parseArgs(argv) {
+    const options = {
+        url: 'http://localhost:3001',
+        mix: null,
+        sizes: 'default',
+        concurrency: 8,
+        rate: 0,
+        'max-in-flight': 1000,
+        duration: 10,
+        requests: 0,
+        warmup: 0,
+        seed: 1,
+        out: 'loadtest.json'
+    };
+    for (const arg of argv) {
+        const match = /^--([a-z-]+)=(.*)$/.exec(arg);
+        if (!match || !(match[1] in options)) {
+            throw new Error(`Unknown option '${arg}' (see the usage at the top of ${path.basename(__filename)})`);
+        }
+        const [, name, value] = match;
+        options[name] = typeof options[name] === 'number' ? Number(value) : value;
+        if (Number.isNaN(options[name])) throw new Error(`--${name} takes a number`);
+    }
+    return options;
+}
+
+// mulberry32: small, fast and seedable, so runs are reproducible
+function random(seed) {
+    let state = seed >>> 0;
+    return () => {
+        state = (state + 0x6d2b79f5) >>> 0;
+        let t = state;
+        t = Math.imul(t ^ (t >>> 15), t | 1);
+        t ^= t + Math.imul(t ^ (t >>> 7), t | 61);
+        return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+    };
+}
+
+// The request body for a problem's default inputs, as InterviewMode sends it
+function defaultInputs(problem) {
+    return (problem.inputs || []).flatMap(input => {
+        if (input.type === 'array') {
+            return input.defaultValue.split(',').map(s => s.trim()).filter(s => s !== '');
+        }
+        return [input.defaultValue];
+    });
+}
+
+// Inputs of size n: the problem's defaults, with list inputs replaced by n
+// random values and strings by n random characters, within the limits of
+// the algorithm's description
+function sizedInputs(problem, description, n, rand) {
+    const defaults = defaultInputs(problem);
+    if (!description) return defaults;
+    const args = [];
+    let next = 0;
+    for (const input of description.inputs) {
+        if (input.type === 'int') {
+            if (next < defaults.length) args.push(defaults[next++]);
+        } else if (input.type === 'string') {
+            const charset = input.charset || 'abcdefghijklmnopqrstuvwxyz';
+            const length = Math.min(n, input.max_length ?? n);
+            args.push(Array.from({ length }, () => charset[Math.floor(rand() * charset.length)]).join(''));
+            next++;
+        } else {
+            const count = Math.min(n, input.max_items ?? n, MAX_INPUTS - args.length);
+            const min = input.min ?? 0;
+            const max = input.max ?? 999;
+            for (let i = 0; i < count; i++) {
+                args.push(String(min + Math.floor(rand() * (max - min + 1))));
+            }
+            next = defaults.length;
+        }
+    }
+    return args;
+}
+
+function percentiles(values) {
+    const sorted = Float64Array.from(values).sort();
+    const at = p => (sorted.length ? sorted[Math.min(sorted.length - 1, Math.ceil(sorted.length * p) - 1)] : 0);
+    const round = ms => Math.round(ms * 1000) / 1000;
+    const sum = sorted.reduce((a, b) => a + b, 0);
+    return {
+        p50: round(at(0.5)),
+        p90: round(at(0.9)),
+        p99: round(at(0.99)),
+        p99_9: round(at(0.999)),
+        max: round(sorted.length ? sorted[sorted.length - 1] : 0),
+        mean: round(sorted.length ? sum / sorted.length : 0)
+    };
+}
+
+async function main() {
+    const options = parseArgs(process.argv.slice(2));
+    const { PROBLEMS } = await import(pathToFileURL(PROBLEMS_FILE).href);
+    const rand = random(options.seed);
+
+    const response = await fetch(`${options.url}/algorithms`);
+    if (!response.ok) throw new Error(`GET /algorithms: ${response.status}`);
+    const descriptions = await response.json();
+
+    const weights = options.mix
+        ? options.mix.split(',').map(entry => {
+            const [name, weight = '1'] = entry.split('=');
+            return { name, weight: Number(weight) };
+        })
+        : PROBLEMS.map(problem => ({ name: problem.id, weight: 1 }));
+    const mix = weights.map(({ name, weight }) => {
+        const problem = PROBLEMS.find(p => p.id === name);
+        if (!problem) throw new Error(`No problem '${name}' in ${PROBLEMS_FILE}`);
+        if (!descriptions[name]) console.warn(`'${name}' is not available on the server`);
+        return { name, weight, problem, description: descriptions[name] };
+    });
+    const totalWeight = mix.reduce((sum, entry) => sum + entry.weight, 0);
+    const sizes = options.sizes.split(',').map(size => (size === 'default' ? null : Number(size)));
+
+    // The next request of the sequence
+    const nextRequest = () => {
+        let pick = rand() * totalWeight;
+        const entry = mix.find(candidate => (pick -= candidate.weight) < 0) || mix[mix.length - 1];
+        const size = sizes[Math.floor(rand() * sizes.length)];
+        const inputs = size === null
+            ? defaultInputs(entry.problem)
+            : sizedInputs(entry.problem, entry.description, size, rand);
+        return { algorithm: entry.name, size: size === null ? 'default' : size, body: JSON.stringify({ inputs }) };
+    };
+
+    const results = []; // { algorithm, size, status, cache, ms, bytes }
+    let measuring = options.warmup <= 0;
+    let measureStart = performance.now();
+    const send = async (request, scheduled) => {
+        let status = 0;
+        let cache = null;
+        let bytes = 0;
+        try {
+            const res = await fetch(`${options.url}/run/${request.algorithm}`, {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/json' },
+                body: request.body
+            });
+            status = res.status;
+            cache = res.headers.get('x-trace-cache');
+            bytes = (await res.arrayBuffer()).byteLength;
+        } catch {
+            status = 0; // connection failed
+        }
+        if (measuring && scheduled >= measureStart) {
+            results.push({ algorithm: request.algorithm, size: request.size, status, cache, ms: performance.now() - scheduled, bytes });
+        }
+    };
+
+    const start = performance.now();
+    if (options.warmup > 0) {
+        setTimeout(() => {
+            measuring = true;
+            measureStart = performance.now();
+        }, options.warmup * 1000);
+    }
+    const deadline = start + (options.warmup + options.duration) * 1000;
+    const done = sent => (options.requests > 0 ? sent >= options.requests : performance.now() >= deadline);
+    let sent = 0;
+    let dropped = 0;
+
+    if (options.rate > 0) {
+        let inFlight = 0;
+        const pending = new Set();
+        const interval = 1000 / options.rate;
+        await new Promise(resolve => {
+            const tick = () => {
+                const now = performance.now();
+                while (!done(sent) && start + sent * interval <= now) {
+                    const scheduled = start + sent * interval;
+                    const request = nextRequest();
+                    sent++;
+                    if (inFlight >= options['max-in-flight']) {
+                        if (measuring) dropped++;
+                        continue;
+                    }
+                    inFlight++;
+                    const run = send(request, scheduled).finally(() => {
+                        inFlight--;
+                        pending.delete(run);
+                    });
+                    pending.add(run);
+                }
+                if (done(sent)) return Promise.all(pending).then(resolve);
+                setTimeout(tick, Math.max(0, start + sent * interval - performance.now()));
+            };
+            tick();
+        });
+    } else {
+        const worker = async () => {
+            while (!done(sent)) {
+                sent++;
+                await send(nextRequest(), performance.now());
+            }
+        };
+        await Promise.all(Array.from({ length: options.concurrency }, worker));
+    }
+    const elapsed = (performance.now() - measureStart) / 1000;
+
+    const count = (list, key) => {
+        const counts = {};
+        for (const item of list) counts[item[key] ?? 'none'] = (counts[item[key] ?? 'none'] || 0) + 1;
+        return counts;
+    };
+    const byAlgorithm = {};
+    for (const { name } of mix) {
+        const own = results.filter(result => result.algorithm === name);
+        if (own.length === 0) continue;
+        byAlgorithm[name] = {
+            requests: own.length,
+            errors: own.filter(result => result.status !== 200).length,
+            latency_ms: percentiles(own.map(result => result.ms))
+        };
+    }
+    const ok = results.filter(result => result.status === 200);
+    const report = {
+        options,
+        requests: results.length,
+        dropped,
+        duration_s: Math.round(elapsed * 1000) / 1000,
+        throughput_rps: Math.round(results.length / elapsed * 100) / 100,
+        ok_throughput_rps: Math.round(ok.length / elapsed * 100) / 100,
+        bytes_received: results.reduce((sum, result) => sum + result.bytes, 0),
+        status: count(results, 'status'),
+        cache: count(ok, 'cache'),
+        latency_ms: percentiles(results.map(result => result.ms)),
+        ok_latency_ms: percentiles(ok.map(result => result.ms)),
+        by_algorithm: byAlgorithm
+    };
+    fs.writeFileSync(options.out, JSON.stringify(report, null, 2) + '\n');
+
+    const l = report.latency_ms;
+    console.log(`${report.requests} requests in ${report.duration_s}s: ${report.throughput_rps} req/s, ` +
+        `p50 ${l.p50}ms p90 ${l.p90}ms p99 ${l.p99}ms p99.9 ${l.p99_9}ms; status ${JSON.stringify(report.status)}` +
+        (dropped ? `, ${dropped} dropped` : ''));
+    console.log(`Report written to ${options.out}`);
+}
+
+main().catch(err => {
+    console.error('loadtest:', err.message);
+    process.exit(1);
+});
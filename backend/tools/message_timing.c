@@ -0,0 +1,14 @@
+#include "log_messages.h"
+#include "logger.h"
+
+// message_timing: one step that does nothing but format its message, over
+// and over. Under LOG_TIMING=1 nearly all of the run is logger time, which
+// `make test` checks against the summary's algorithm_ns and logger_ns.
+int main() {
+    log_init();
+    log_step_start();
+    for (int i = 0; i < 200000; i++) log_message_fmt(MSG_BUBBLE_COMPARE, i, i + 1);
+    log_step_end();
+    log_finish();
+    return 0;
+}
@@ -0,0 +1,34 @@
+#include <string.h>
+
+#include "multicall.h"
+
+// multicall_algorithms.h is generated from the Makefile's ALGORITHMS: one
+// MULTICALL_ALGORITHM(ident, name) line per program.
+#define MULTICALL_ALGORITHM(ident, name) int algorithm_main_##ident(int argc, char* argv[]);
+#include "multicall_algorithms.h"
+#undef MULTICALL_ALGORITHM
+
+const Algorithm algorithms[] = {
+#define MULTICALL_ALGORITHM(ident, name) {name, algorithm_main_##ident},
+#include "multicall_algorithms.h"
+#undef MULTICALL_ALGORITHM
+};
+
+const size_t algorithm_count = sizeof(algorithms) / sizeof(algorithms[0]);
+
+AlgorithmMain find_algorithm(const char* name) {
+    for (size_t i = 0; i < algorithm_count; i++) {
+        if (strcmp(algorithms[i].name, name) == 0) return algorithms[i].main;
+    }
+    return NULL;
+}
+
+// The programs are compiled with -Dstrtok=multicall_strtok: strtok() keeps
+// its position in a global, this keeps it per thread (the runner runs
+// programs on several threads at once).
+char* multicall_strtok(char* s, const char* delim);
+
+char* multicall_strtok(char* s, const char* delim) {
+    static _Thread_local char* position;
+    return strtok_r(s, delim, &position);
+}
@@ -0,0 +1,25 @@
+#ifndef MULTICALL_H
+#define MULTICALL_H
+
+#include <stddef.h>
+
+// Every program in src/ linked into one binary (build/algoviz and
+// build/runner). The Makefile compiles each program with
+// -DALGORITHM_MULTICALL, so its entry point is algorithm_main_<name> (see
+// ALGORITHM_MAIN in logger.h), and makes every other global symbol local,
+// so helpers such as swap() don't clash between programs.
+
+typedef int (*AlgorithmMain)(int argc, char* argv[]);
+
+typedef struct {
+    const char* name; // as in the Makefile's ALGORITHMS ("valid-parentheses")
+    AlgorithmMain main;
+} Algorithm;
+
+extern const Algorithm algorithms[];
+extern const size_t algorithm_count;
+
+// The entry point of the named program, or NULL.
+AlgorithmMain find_algorithm(const char* name);
+
+#endif // MULTICALL_H
@@ -0,0 +1,299 @@
+#include <errno.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "logger.h"
+#include "multicall.h"
+
+// runner: runs the algorithms in one long-lived process for server.js.
+// Usage: runner [--threads T]
+//   Every program in src/ is linked in (see multicall.h). Requests are read
+//   from stdin and run on T worker threads (default: one per core), each
+//   with its own logger context; traces are streamed back on stdout as they
+//   are written.
+//   The runner exits once stdin is closed and the requests in flight are
+//   done.
+//
+// Frames, both ways: u32 length (little-endian), then length bytes.
+//   request   NUL-terminated strings: id, algorithm, options, "", arguments
+//             Options are LOG_* settings as NAME=value (LOG_MAX_STEPS=2000,
+//             LOG_COMPRESS=gzip, ...); the environment is not consulted.
+//             MAX_OUTPUT=N stops the run once its trace is over N bytes: the
+//             'D' frame that went over is sent, then an 'X'.
+//   response  id (NUL-terminated), u8 type, payload:
+//             'D'  the next chunk of the trace
+//             'E'  the run is over; payload is main()'s return value in decimal
+//             'X'  the request was rejected, or the run was stopped (logger
+//                  out of memory, over MAX_OUTPUT, ...); payload is the reason
+//   Responses to different requests interleave. Each request gets any number
+//   of 'D' frames and then exactly one 'E' or 'X'.
+
+#define MAX_REQUEST (1 << 20)
+#define WORKER_STACK (8 << 20)
+
+typedef struct Job {
+    struct Job* next;
+    uint32_t len;
+    char data[]; // the request frame, NUL-terminated strings
+} Job;
+
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_ready = PTHREAD_COND_INITIALIZER;
+static Job* queue_head;
+static Job* queue_tail;
+static int queue_closed;
+
+static pthread_mutex_t out_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void write_all(const void* data, size_t len) {
+    const char* p = data;
+    while (len > 0) {
+        ssize_t n = write(STDOUT_FILENO, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            perror("runner: write");
+            exit(1);
+        }
+        p += n;
+        len -= n;
+    }
+}
+
+static int read_all(void* data, size_t len) {
+    char* p = data;
+    while (len > 0) {
+        ssize_t n = read(STDIN_FILENO, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        p += n;
+        len -= n;
+    }
+    return 1;
+}
+
+static void put_u32(unsigned char* p, uint32_t v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+}
+
+// Writes one response frame; frames from different threads never mix.
+static void send_frame(const char* id, char type, const void* data, size_t len) {
+    size_t id_len = strlen(id) + 1;
+    unsigned char header[4];
+    put_u32(header, (uint32_t)(id_len + 1 + len));
+    pthread_mutex_lock(&out_lock);
+    write_all(header, 4);
+    write_all(id, id_len);
+    write_all(&type, 1);
+    write_all(data, len);
+    pthread_mutex_unlock(&out_lock);
+}
+
+static void send_text(const char* id, char type, const char* text) {
+    send_frame(id, type, text, strlen(text));
+}
+
+// Where a worker's logger failure lands: back in run_job(), out of the
+// algorithm, so that only that request fails.
+static _Thread_local jmp_buf failure_jump;
+static _Thread_local const char* failure_reason;
+
+static void worker_failure(const char* reason) {
+    failure_reason = reason;
+    longjmp(failure_jump, 1);
+}
+
+// The request a worker is running; the user pointer of its logger sink.
+typedef struct {
+    const char* id;
+    size_t sent;
+    size_t max_output; // 0: no limit
+} Running;
+
+// Logger sink of a worker. A trace over its MAX_OUTPUT ends the run like a
+// logger failure, rather than being written out to the end for nothing.
+static void trace_sink(void* user, const void* data, size_t len) {
+    Running* run = user;
+    send_frame(run->id, 'D', data, len);
+    run->sent += len;
+    if (run->max_output > 0 && run->sent > run->max_output) worker_failure("trace too large");
+}
+
+// Returns 0 when the run failed halfway; ctx must not be used again then.
+static int run_job(LogCtx* ctx, Running* run, Job* job) {
+    // Split the frame into its strings.
+    int count = 0;
+    for (uint32_t i = 0; i < job->len; i++) count += job->data[i] == '\0';
+    char** fields = malloc((count + 1) * sizeof(char*));
+    char* p = job->data;
+    for (int i = 0; i < count; i++) {
+        fields[i] = p;
+        p += strlen(p) + 1;
+    }
+    fields[count] = NULL;
+
+    const char* id = count > 0 ? fields[0] : "";
+    if (count < 3) {
+        send_text(id, 'X', "malformed request");
+        free(fields);
+        return 1;
+    }
+    AlgorithmMain algorithm = find_algorithm(fields[1]);
+    if (algorithm == NULL) {
+        send_text(id, 'X', "unknown algorithm");
+        free(fields);
+        return 1;
+    }
+
+    LogOptions options = {0};
+    size_t max_output = 0;
+    int i = 2;
+    for (; i < count && fields[i][0] != '\0'; i++) {
+        char* value = strchr(fields[i], '=');
+        if (value != NULL) *value++ = '\0';
+        if (value != NULL && strcmp(fields[i], "MAX_OUTPUT") == 0) {
+            max_output = strtoull(value, NULL, 10);
+        } else if (value == NULL || !log_option_set(&options, fields[i], value)) {
+            send_text(id, 'X', "unknown option");
+            free(fields);
+            return 1;
+        }
+    }
+    if (i == count) {
+        send_text(id, 'X', "malformed request");
+        free(fields);
+        return 1;
+    }
+
+    // argv[0] is the algorithm name, as if it had been exec()-ed.
+    fields[i] = fields[1];
+    char** argv = &fields[i];
+    int argc = count - i;
+
+    log_ctx_set_options(ctx, &options);
+    *run = (Running){id, 0, max_output};
+    if (setjmp(failure_jump) != 0) {
+        // Going over MAX_OUTPUT is the caller's limit, not a failure.
+        if (run->max_output == 0 || run->sent <= run->max_output) {
+            fprintf(stderr, "runner: %s: logger: %s\n", fields[1], failure_reason);
+        }
+        send_text(id, 'X', failure_reason);
+        free(fields);
+        return 0;
+    }
+    int status = algorithm(argc, argv);
+
+    char text[16];
+    snprintf(text, sizeof(text), "%d", status);
+    send_text(id, 'E', text);
+    free(fields);
+    return 1;
+}
+
+static Job* next_job() {
+    pthread_mutex_lock(&queue_lock);
+    while (queue_head == NULL && !queue_closed) pthread_cond_wait(&queue_ready, &queue_lock);
+    Job* job = queue_head;
+    if (job != NULL) {
+        queue_head = job->next;
+        if (queue_head == NULL) queue_tail = NULL;
+    }
+    pthread_mutex_unlock(&queue_lock);
+    return job;
+}
+
+static void* worker(void* arg) {
+    (void)arg;
+    Running run = {"", 0, 0};
+    LogCtx* ctx = log_ctx_create(NULL, trace_sink, &run);
+    log_bind_ctx(ctx);
+    log_on_failure(worker_failure);
+    Job* job;
+    while ((job = next_job()) != NULL) {
+        if (!run_job(ctx, &run, job)) {
+            // The run stopped halfway through a trace and left the context
+            // as it was: start over with a new one.
+            log_bind_ctx(NULL);
+            log_ctx_abandon(ctx);
+            ctx = log_ctx_create(NULL, trace_sink, &run);
+            log_bind_ctx(ctx);
+        }
+        run = (Running){"", 0, 0};
+        free(job);
+    }
+    log_bind_ctx(NULL);
+    log_ctx_destroy(ctx);
+    return NULL;
+}
+
+static void push_job(Job* job) {
+    pthread_mutex_lock(&queue_lock);
+    job->next = NULL;
+    if (queue_tail != NULL) {
+        queue_tail->next = job;
+    } else {
+        queue_head = job;
+    }
+    queue_tail = job;
+    pthread_cond_signal(&queue_ready);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+int main(int argc, char* argv[]) {
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atol(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: runner [--threads T]\n");
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, WORKER_STACK);
+    pthread_t* workers = malloc(threads * sizeof(pthread_t));
+    for (long i = 0; i < threads; i++) {
+        if (pthread_create(&workers[i], &attr, worker, NULL) != 0) {
+            fprintf(stderr, "runner: cannot start worker threads\n");
+            return 1;
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    unsigned char header[4];
+    while (read_all(header, 4)) {
+        uint32_t len = header[0] | header[1] << 8 | header[2] << 16 | (uint32_t)header[3] << 24;
+        if (len > MAX_REQUEST) {
+            fprintf(stderr, "runner: request of %u bytes is too large\n", len);
+            return 1;
+        }
+        // One extra NUL so a truncated last string still ends.
+        Job* job = malloc(sizeof(Job) + len + 1);
+        if (job == NULL || !read_all(job->data, len)) {
+            fprintf(stderr, "runner: truncated request\n");
+            return 1;
+        }
+        job->data[len] = '\0';
+        job->len = len;
+        if (len == 0 || job->data[len - 1] != '\0') job->len = len + 1;
+        push_job(job);
+    }
+
+    pthread_mutex_lock(&queue_lock);
+    queue_closed = 1;
+    pthread_cond_broadcast(&queue_ready);
+    pthread_mutex_unlock(&queue_lock);
+    for (long i = 0; i < threads; i++) pthread_join(workers[i], NULL);
+    free(workers);
+    return 0;
+}
@@ -0,0 +1,470 @@
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+struct ArenaBlock {
+    ArenaBlock* next;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
+void* arena_alloc(Arena* a, size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    ArenaBlock* b = a->head;
+    if (b == NULL || b->used + size > b->size) {
+        size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        b = malloc(sizeof(ArenaBlock) + block_size);
+        if (b == NULL) {
+            fprintf(stderr, "trace: out of memory\n");
+            exit(1);
+        }
+        b->next = a->head;
+        b->used = 0;
+        b->size = block_size;
+        a->head = b;
+    }
+    void* p = b->data + b->used;
+    b->used += size;
+    return p;
+}
+
+void arena_reset(Arena* a) {
+    // Keep the newest block around, it is almost always big enough.
+    if (a->head == NULL) return;
+    ArenaBlock* b = a->head->next;
+    while (b != NULL) {
+        ArenaBlock* next = b->next;
+        free(b);
+        b = next;
+    }
+    a->head->next = NULL;
+    a->head->used = 0;
+}
+
+void arena_free(Arena* a) {
+    arena_reset(a);
+    free(a->head);
+    a->head = NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Parsing
+
+void trace_reader_init(TraceReader* r, const char* buf, size_t len) {
+    r->buf = buf;
+    r->len = len;
+    r->pos = 0;
+    r->started = 0;
+    r->ndjson = 0;
+    r->error = NULL;
+}
+
+static void skip_ws(TraceReader* r) {
+    while (r->pos < r->len) {
+        char c = r->buf[r->pos];
+        if (c != ' ' && c != '\n' && c != '\r' && c != '\t') break;
+        r->pos++;
+    }
+}
+
+static int peek(TraceReader* r) {
+    skip_ws(r);
+    return r->pos < r->len ? (unsigned char)r->buf[r->pos] : -1;
+}
+
+static int fail(TraceReader* r, const char* msg) {
+    if (r->error == NULL) r->error = msg;
+    return -1;
+}
+
+static char* parse_string(TraceReader* r, Arena* a) {
+    // Caller has checked the opening quote.
+    r->pos++;
+    size_t n = 0;
+    size_t start = r->pos;
+    size_t end = start;
+    while (end < r->len && r->buf[end] != '"') {
+        if (r->buf[end] == '\\') end++;
+        end++;
+    }
+    if (end >= r->len) {
+        fail(r, "unterminated string");
+        return NULL;
+    }
+    char* out = arena_alloc(a, end - start + 1);
+    for (size_t i = start; i < end; i++) {
+        char c = r->buf[i];
+        if (c == '\\' && i + 1 < end) {
+            c = r->buf[++i];
+            switch (c) {
+            case 'n': c = '\n'; break;
+            case 't': c = '\t'; break;
+            case 'r': c = '\r'; break;
+            default: break;
+            }
+        }
+        out[n++] = c;
+    }
+    out[n] = '\0';
+    r->pos = end + 1;
+    return out;
+}
+
+static void grow(Arena* a, JVal* v, int with_keys) {
+    if (v->len < v->cap) return;
+    int cap = v->cap ? v->cap * 2 : 8;
+    JVal* items = arena_alloc(a, cap * sizeof(JVal));
+    if (v->len) memcpy(items, v->items, v->len * sizeof(JVal));
+    v->items = items;
+    if (with_keys) {
+        char** keys = arena_alloc(a, cap * sizeof(char*));
+        if (v->len) memcpy(keys, v->keys, v->len * sizeof(char*));
+        v->keys = keys;
+    }
+    v->cap = cap;
+}
+
+static int parse_value(TraceReader* r, Arena* a, JVal* out, int depth);
+
+static int parse_array(TraceReader* r, Arena* a, JVal* out, int depth) {
+    r->pos++;
+    out->type = JV_ARR;
+    if (peek(r) == ']') {
+        r->pos++;
+        return 0;
+    }
+    for (;;) {
+        grow(a, out, 0);
+        memset(&out->items[out->len], 0, sizeof(JVal));
+        if (parse_value(r, a, &out->items[out->len], depth + 1) < 0) return -1;
+        out->len++;
+        int c = peek(r);
+        r->pos++;
+        if (c == ']') return 0;
+        if (c != ',') return fail(r, "expected ',' or ']'");
+    }
+}
+
+static int parse_object(TraceReader* r, Arena* a, JVal* out, int depth) {
+    r->pos++;
+    out->type = JV_OBJ;
+    if (peek(r) == '}') {
+        r->pos++;
+        return 0;
+    }
+    for (;;) {
+        if (peek(r) != '"') return fail(r, "expected member name");
+        char* key = parse_string(r, a);
+        if (key == NULL) return -1;
+        if (peek(r) != ':') return fail(r, "expected ':'");
+        r->pos++;
+        grow(a, out, 1);
+        out->keys[out->len] = key;
+        memset(&out->items[out->len], 0, sizeof(JVal));
+        if (parse_value(r, a, &out->items[out->len], depth + 1) < 0) return -1;
+        out->len++;
+        int c = peek(r);
+        r->pos++;
+        if (c == '}') return 0;
+        if (c != ',') return fail(r, "expected ',' or '}'");
+    }
+}
+
+static int parse_value(TraceReader* r, Arena* a, JVal* out, int depth) {
+    if (depth > 64) return fail(r, "nesting too deep");
+    int c = peek(r);
+    if (c == '{') return parse_object(r, a, out, depth);
+    if (c == '[') return parse_array(r, a, out, depth);
+    if (c == '"') {
+        out->type = JV_STR;
+        out->text = parse_string(r, a);
+        return out->text ? 0 : -1;
+    }
+
+    size_t start = r->pos;
+    while (r->pos < r->len && strchr(",]}: \n\r\t", r->buf[r->pos]) == NULL) r->pos++;
+    size_t n = r->pos - start;
+    if (n == 0) return fail(r, "unexpected character");
+    out->text = arena_alloc(a, n + 1);
+    memcpy(out->text, r->buf + start, n);
+    out->text[n] = '\0';
+    if (strcmp(out->text, "true") == 0 || strcmp(out->text, "false") == 0) {
+        out->type = JV_BOOL;
+    } else if (strcmp(out->text, "null") == 0) {
+        out->type = JV_NULL;
+    } else {
+        out->type = JV_NUM;
+    }
+    return 0;
+}
+
+int trace_reader_next(TraceReader* r, Arena* arena, JVal* out) {
+    int c = peek(r);
+    if (!r->started) {
+        // NDJSON (LOG_FORMAT=ndjson): one step object per line, no array.
+        r->ndjson = c == '{' || c == -1;
+        if (!r->ndjson && c != '[') return fail(r, "trace must start with '[' or '{'");
+        if (!r->ndjson) r->pos++;
+        r->started = 1;
+        c = peek(r);
+    } else if (c == ',' && !r->ndjson) {
+        r->pos++;
+        c = peek(r);
+    }
+    if (c == ']' || c == -1) return 0;
+
+    memset(out, 0, sizeof(*out));
+    if (parse_value(r, arena, out, 0) < 0) return -1;
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Tree helpers
+
+JVal* jv_get(const JVal* obj, const char* key) {
+    if (obj == NULL || obj->type != JV_OBJ) return NULL;
+    for (int i = 0; i < obj->len; i++) {
+        if (strcmp(obj->keys[i], key) == 0) return &obj->items[i];
+    }
+    return NULL;
+}
+
+int jv_int(const JVal* v) {
+    return (v != NULL && v->type == JV_NUM) ? atoi(v->text) : 0;
+}
+
+JVal jv_make_int(Arena* a, long long value) {
+    JVal v = {0};
+    v.type = JV_NUM;
+    v.text = arena_alloc(a, 24);
+    snprintf(v.text, 24, "%lld", value);
+    return v;
+}
+
+JVal jv_make_array(Arena* a, int cap) {
+    JVal v = {0};
+    v.type = JV_ARR;
+    if (cap > 0) {
+        v.items = arena_alloc(a, cap * sizeof(JVal));
+        v.cap = cap;
+    }
+    return v;
+}
+
+JVal jv_make_object(Arena* a, int cap) {
+    JVal v = {0};
+    v.type = JV_OBJ;
+    if (cap > 0) {
+        v.items = arena_alloc(a, cap * sizeof(JVal));
+        v.keys = arena_alloc(a, cap * sizeof(char*));
+        v.cap = cap;
+    }
+    return v;
+}
+
+JVal jv_make_string(char* text) {
+    JVal v = {0};
+    v.type = JV_STR;
+    v.text = text;
+    return v;
+}
+
+void jv_set(Arena* a, JVal* obj, char* key, JVal value) {
+    grow(a, obj, 1);
+    obj->keys[obj->len] = key;
+    obj->items[obj->len++] = value;
+}
+
+JVal jv_copy(Arena* a, const JVal* v) {
+    JVal c = *v;
+    if (v->text != NULL) {
+        size_t n = strlen(v->text) + 1;
+        c.text = memcpy(arena_alloc(a, n), v->text, n);
+    }
+    if (v->type == JV_ARR || v->type == JV_OBJ) {
+        c.cap = v->len;
+        c.items = v->len ? arena_alloc(a, v->len * sizeof(JVal)) : NULL;
+        c.keys = v->type == JV_OBJ && v->len ? arena_alloc(a, v->len * sizeof(char*)) : NULL;
+        for (int i = 0; i < v->len; i++) {
+            c.items[i] = jv_copy(a, &v->items[i]);
+            if (c.keys != NULL) {
+                size_t n = strlen(v->keys[i]) + 1;
+                c.keys[i] = memcpy(arena_alloc(a, n), v->keys[i], n);
+            }
+        }
+    }
+    return c;
+}
+
+void jv_push(Arena* a, JVal* arr, JVal item) {
+    grow(a, arr, 0);
+    arr->items[arr->len++] = item;
+}
+
+void jv_remove(JVal* obj, const char* key) {
+    if (obj == NULL || obj->type != JV_OBJ) return;
+    for (int i = 0; i < obj->len; i++) {
+        if (strcmp(obj->keys[i], key) == 0) {
+            memmove(&obj->items[i], &obj->items[i + 1], (obj->len - i - 1) * sizeof(JVal));
+            memmove(&obj->keys[i], &obj->keys[i + 1], (obj->len - i - 1) * sizeof(char*));
+            obj->len--;
+            return;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Replay
+
+void trace_replay_init(TraceReplay* rp) {
+    memset(rp, 0, sizeof(*rp));
+    rp->nodes.type = JV_ARR;
+    rp->edges.type = JV_ARR;
+}
+
+void trace_replay_free(TraceReplay* rp) {
+    for (int i = 0; i < rp->cap; i++) {
+        free(rp->arrays[i].name);
+        free(rp->arrays[i].data);
+    }
+    free(rp->arrays);
+    arena_free(&rp->graph_arena);
+    memset(rp, 0, sizeof(*rp));
+}
+
+static ReplayArray* replay_find(TraceReplay* rp, const char* name) {
+    for (int i = 0; i < rp->count; i++) {
+        if (strcmp(rp->arrays[i].name, name) == 0) return &rp->arrays[i];
+    }
+    return NULL;
+}
+
+static ReplayArray* replay_slot(TraceReplay* rp, const char* name) {
+    ReplayArray* ra = replay_find(rp, name);
+    if (ra != NULL) return ra;
+    if (rp->count == rp->cap) {
+        int cap = rp->cap ? rp->cap * 2 : 8;
+        rp->arrays = realloc(rp->arrays, cap * sizeof(ReplayArray));
+        memset(rp->arrays + rp->cap, 0, (cap - rp->cap) * sizeof(ReplayArray));
+        rp->cap = cap;
+    }
+    // Slots past count keep their buffers from before the last keyframe.
+    ra = &rp->arrays[rp->count++];
+    free(ra->name);
+    ra->name = strdup(name);
+    ra->size = 0;
+    return ra;
+}
+
+static void replay_store(ReplayArray* ra, const JVal* values) {
+    if (values->len > ra->cap) {
+        ra->cap = values->len;
+        ra->data = realloc(ra->data, ra->cap * sizeof(int));
+    }
+    ra->size = values->len;
+    for (int i = 0; i < values->len; i++) ra->data[i] = jv_int(&values->items[i]);
+}
+
+// Appends the entries listed under added_key to the accumulated list and
+// puts the whole list under key in its place.
+static void replay_graph(TraceReplay* rp, JVal* step, const char* added_key, char* key, JVal* all) {
+    for (int i = 0; i < step->len; i++) {
+        if (strcmp(step->keys[i], added_key) != 0) continue;
+        JVal* added = &step->items[i];
+        for (int j = 0; j < added->len; j++) {
+            jv_push(&rp->graph_arena, all, jv_copy(&rp->graph_arena, &added->items[j]));
+        }
+        step->keys[i] = key;
+        step->items[i] = *all;
+        return;
+    }
+}
+
+int trace_replay_apply(TraceReplay* rp, Arena* arena, JVal* step) {
+    // The trailing summary record is not a step and passes through as is.
+    if (jv_get(step, "summary") != NULL) return 0;
+
+    JVal* kf = jv_get(step, "keyframe");
+    if (kf != NULL) {
+        if (kf->type == JV_BOOL && kf->text[0] == 't') rp->count = 0;
+        jv_remove(step, "keyframe");
+    }
+
+    JVal* arrays = jv_get(step, "arrays");
+    if (arrays != NULL && arrays->type == JV_OBJ) {
+        for (int i = 0; i < arrays->len; i++) {
+            JVal* value = &arrays->items[i];
+            if (value->type == JV_ARR) {
+                replay_store(replay_slot(rp, arrays->keys[i]), value);
+                continue;
+            }
+
+            JVal* set = jv_get(value, "set");
+            ReplayArray* ra = replay_find(rp, arrays->keys[i]);
+            if (set == NULL || ra == NULL) return -1;
+            for (int j = 0; j + 1 < set->len; j += 2) {
+                int index = jv_int(&set->items[j]);
+                if (index < 0 || index >= ra->size) return -1;
+                ra->data[index] = jv_int(&set->items[j + 1]);
+            }
+
+            JVal full = jv_make_array(arena, ra->size);
+            for (int j = 0; j < ra->size; j++) {
+                full.items[j] = jv_make_int(arena, ra->data[j]);
+            }
+            full.len = ra->size;
+            *value = full;
+        }
+    }
+
+    replay_graph(rp, step, "nodes_added", "nodes", &rp->nodes);
+    replay_graph(rp, step, "edges_added", "edges", &rp->edges);
+
+    rp->step++;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Printing
+
+void trace_print_value(FILE* out, const JVal* v) {
+    switch (v->type) {
+    case JV_STR:
+        fprintf(out, "\"%s\"", v->text);
+        break;
+    case JV_ARR:
+        fputc('[', out);
+        for (int i = 0; i < v->len; i++) {
+            if (i) fputs(", ", out);
+            trace_print_value(out, &v->items[i]);
+        }
+        fputc(']', out);
+        break;
+    case JV_OBJ:
+        fputc('{', out);
+        for (int i = 0; i < v->len; i++) {
+            if (i) fputs(", ", out);
+            fprintf(out, "\"%s\": ", v->keys[i]);
+            trace_print_value(out, &v->items[i]);
+        }
+        fputc('}', out);
+        break;
+    default:
+        fputs(v->text, out);
+        break;
+    }
+}
+
+void trace_print_step(FILE* out, const JVal* step) {
+    fputs("  {\n", out);
+    for (int i = 0; i < step->len; i++) {
+        fprintf(out, "    \"%s\": ", step->keys[i]);
+        trace_print_value(out, &step->items[i]);
+        fputs(i < step->len - 1 ? ",\n" : "\n", out);
+    }
+    fputs("  }", out);
+}
@@ -0,0 +1,119 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Reader side of the logger's trace formats. A trace is parsed one step at a
+// time into a small JSON tree, then passed through a TraceReplay which turns
+// delta steps back into the full step objects the frontend expects.
+
+typedef enum { JV_NULL, JV_BOOL, JV_NUM, JV_STR, JV_ARR, JV_OBJ } JvType;
+
+typedef struct JVal {
+    JvType type;
+    char* text;         // raw token for numbers/booleans, contents for strings
+    int len;            // number of items (arrays) or members (objects)
+    int cap;
+    struct JVal* items; // array items or object member values
+    char** keys;        // object member names
+} JVal;
+
+// Bump allocator backing every JVal of a step. Reset between steps.
+typedef struct ArenaBlock ArenaBlock;
+typedef struct {
+    ArenaBlock* head;
+} Arena;
+
+void* arena_alloc(Arena* a, size_t size);
+void arena_reset(Arena* a);
+void arena_free(Arena* a);
+
+// Streaming reader over an in-memory trace: the top-level JSON array, or
+// one step object per line in NDJSON traces.
+typedef struct {
+    const char* buf;
+    size_t len;
+    size_t pos;
+    int started;
+    int ndjson;
+    const char* error;
+} TraceReader;
+
+void trace_reader_init(TraceReader* r, const char* buf, size_t len);
+
+// Parses the next step into *out. Returns 1 on success, 0 at the end of the
+// trace and -1 on a syntax error (r->error describes it).
+int trace_reader_next(TraceReader* r, Arena* arena, JVal* out);
+
+// JSON tree helpers
+JVal* jv_get(const JVal* obj, const char* key);
+int jv_int(const JVal* v);
+JVal jv_make_int(Arena* a, long long value);
+JVal jv_make_array(Arena* a, int cap);
+JVal jv_make_object(Arena* a, int cap);
+JVal jv_make_string(char* text);
+void jv_push(Arena* a, JVal* arr, JVal item);
+void jv_set(Arena* a, JVal* obj, char* key, JVal value);
+void jv_remove(JVal* obj, const char* key);
+// Deep copy of v (strings included) into a.
+JVal jv_copy(Arena* a, const JVal* v);
+
+// Streaming reader over a binary trace (LOG_FORMAT=binary, see
+// trace_format.h). Steps are decoded into the same JSON tree the text reader
+// produces, so replay and printing are shared. Owns the string table.
+typedef struct {
+    const unsigned char* buf;
+    size_t len;
+    size_t pos;
+    int flags;
+    char** strings;
+    int string_count;
+    int string_cap;
+    const char* error;
+} TraceBinReader;
+
+int trace_is_binary(const char* buf, size_t len);
+
+// Returns 0 on success, -1 if the header is missing or the version unknown.
+int trace_bin_init(TraceBinReader* r, const char* buf, size_t len);
+
+// Same contract as trace_reader_next.
+int trace_bin_next(TraceBinReader* r, Arena* arena, JVal* out);
+void trace_bin_free(TraceBinReader* r);
+
+// Replay state: the current contents of every named array since the last
+// keyframe, plus every tree node and edge seen so far (delta traces only
+// list the ones each step added, and never repeat them at keyframes).
+typedef struct {
+    char* name;
+    int* data;
+    int size;
+    int cap;
+} ReplayArray;
+
+typedef struct {
+    ReplayArray* arrays;
+    int count;
+    int cap;
+    Arena graph_arena;
+    JVal nodes;
+    JVal edges;
+    long step;
+} TraceReplay;
+
+void trace_replay_init(TraceReplay* rp);
+void trace_replay_free(TraceReplay* rp);
+
+// Applies one parsed step to the replay state and rewrites it in place into
+// its full form (delta arrays expanded, nodes_added/edges_added replaced by
+// the full nodes/edges lists, keyframe marker removed). A trailing
+// {"summary": ...} record is left untouched and not counted as a step. Returns 0
+// on success, -1 if the step references an array with no prior state.
+int trace_replay_apply(TraceReplay* rp, Arena* arena, JVal* step);
+
+// Writers producing byte-for-byte the layout of the logger's full JSON mode.
+void trace_print_value(FILE* out, const JVal* v);
+void trace_print_step(FILE* out, const JVal* step);
+
+#endif // TRACE_H
@@ -0,0 +1,288 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+#include "trace_format.h"
+
+// Decoder for binary traces. Every step is rebuilt as the JSON tree the
+// logger would have printed in text mode (delta columns become {"set": ...}),
+// so the replay and printing code in trace.c handles both formats.
+
+int trace_is_binary(const char* buf, size_t len) {
+    return len >= 4 && memcmp(buf, TRACE_MAGIC, 4) == 0;
+}
+
+static int bin_fail(TraceBinReader* r, const char* msg) {
+    if (r->error == NULL) r->error = msg;
+    return -1;
+}
+
+static int need(TraceBinReader* r, size_t n) {
+    return r->pos + n <= r->len;
+}
+
+static unsigned get_u8(TraceBinReader* r) {
+    return r->buf[r->pos++];
+}
+
+static unsigned get_u16(TraceBinReader* r) {
+    unsigned v = r->buf[r->pos] | (r->buf[r->pos + 1] << 8);
+    r->pos += 2;
+    return v;
+}
+
+static unsigned get_u32(TraceBinReader* r) {
+    const unsigned char* p = r->buf + r->pos;
+    r->pos += 4;
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+static long long get_i64(TraceBinReader* r) {
+    unsigned lo = get_u32(r);
+    unsigned hi = get_u32(r);
+    return (long long)(((unsigned long long)hi << 32) | lo);
+}
+
+int trace_bin_init(TraceBinReader* r, const char* buf, size_t len) {
+    memset(r, 0, sizeof(*r));
+    r->buf = (const unsigned char*)buf;
+    r->len = len;
+    if (!trace_is_binary(buf, len) || len < 8) return bin_fail(r, "missing binary trace header");
+    r->pos = 4;
+    if (get_u16(r) != TRACE_VERSION) return bin_fail(r, "unsupported binary trace version");
+    r->flags = get_u16(r);
+    return 0;
+}
+
+void trace_bin_free(TraceBinReader* r) {
+    for (int i = 0; i < r->string_count; i++) free(r->strings[i]);
+    free(r->strings);
+    r->strings = NULL;
+    r->string_count = 0;
+    r->string_cap = 0;
+}
+
+static int read_string_record(TraceBinReader* r) {
+    if (!need(r, 4)) return bin_fail(r, "truncated string record");
+    size_t n = get_u32(r);
+    if (!need(r, n)) return bin_fail(r, "truncated string record");
+    if (r->string_count == r->string_cap) {
+        r->string_cap = r->string_cap ? r->string_cap * 2 : 256;
+        r->strings = realloc(r->strings, r->string_cap * sizeof(char*));
+    }
+    char* s = malloc(n + 1);
+    memcpy(s, r->buf + r->pos, n);
+    s[n] = '\0';
+    r->strings[r->string_count++] = s;
+    r->pos += n;
+    return 0;
+}
+
+static char* string_ref(TraceBinReader* r, unsigned id) {
+    if (id >= (unsigned)r->string_count) {
+        bin_fail(r, "reference to undefined string");
+        return NULL;
+    }
+    return r->strings[id];
+}
+
+static int read_array(TraceBinReader* r, Arena* a, JVal* arrays) {
+    if (!need(r, 9)) return bin_fail(r, "truncated array");
+    char* name = string_ref(r, get_u32(r));
+    unsigned column = get_u8(r);
+    unsigned count = get_u32(r);
+    if (name == NULL) return -1;
+
+    if (column == TRACE_COL_DELTA) {
+        if (!need(r, (size_t)count * 8)) return bin_fail(r, "truncated array");
+        JVal pairs = jv_make_array(a, count * 2);
+        for (unsigned i = 0; i < count * 2; i++) {
+            pairs.items[i] = jv_make_int(a, (int)get_u32(r));
+        }
+        pairs.len = count * 2;
+        JVal set = jv_make_object(a, 1);
+        jv_set(a, &set, "set", pairs);
+        jv_set(a, arrays, name, set);
+        return 0;
+    }
+
+    if (column != TRACE_COL_I8 && column != TRACE_COL_I16 && column != TRACE_COL_I32) {
+        return bin_fail(r, "unknown array column type");
+    }
+    if (!need(r, (size_t)count * column)) return bin_fail(r, "truncated array");
+    JVal values = jv_make_array(a, count);
+    for (unsigned i = 0; i < count; i++) {
+        int v;
+        if (column == TRACE_COL_I8) {
+            v = (signed char)get_u8(r);
+        } else if (column == TRACE_COL_I16) {
+            v = (short)get_u16(r);
+        } else {
+            v = (int)get_u32(r);
+        }
+        values.items[i] = jv_make_int(a, v);
+    }
+    values.len = count;
+    jv_set(a, arrays, name, values);
+    return 0;
+}
+
+// Reads a list of (u32 name, i32 value) records into an object.
+static int read_named_ints(TraceBinReader* r, Arena* a, JVal* out) {
+    if (!need(r, 4)) return bin_fail(r, "truncated step");
+    unsigned count = get_u32(r);
+    if (!need(r, (size_t)count * 8)) return bin_fail(r, "truncated step");
+    *out = jv_make_object(a, count);
+    for (unsigned i = 0; i < count; i++) {
+        char* name = string_ref(r, get_u32(r));
+        if (name == NULL) return -1;
+        jv_set(a, out, name, jv_make_int(a, (int)get_u32(r)));
+    }
+    return 0;
+}
+
+// Reads the arguments of a templated message and returns its text, with
+// every %d replaced by the next argument and %% by %.
+static char* read_template_args(TraceBinReader* r, Arena* a, const char* tmpl) {
+    if (!need(r, 4)) {
+        bin_fail(r, "truncated step");
+        return NULL;
+    }
+    unsigned argc = get_u32(r);
+    if (!need(r, (size_t)argc * 4)) {
+        bin_fail(r, "truncated step");
+        return NULL;
+    }
+    char* text = arena_alloc(a, strlen(tmpl) + (size_t)argc * 11 + 1);
+    char* out = text;
+    unsigned arg = 0;
+    for (const char* p = tmpl; *p; p++) {
+        if (*p != '%') {
+            *out++ = *p;
+        } else if (p[1] == '\0') {
+            break;
+        } else if (*++p == 'd' && arg < argc) {
+            out += sprintf(out, "%d", (int)get_u32(r));
+            arg++;
+        } else if (*p == '%') {
+            *out++ = '%';
+        }
+    }
+    *out = '\0';
+    // Skip arguments the template had no conversion for.
+    r->pos += (size_t)(argc - arg) * 4;
+    return text;
+}
+
+static JVal read_ops(TraceBinReader* r, Arena* a) {
+    static char* const names[] = {"comparisons", "swaps", "reads", "writes"};
+    JVal ops = jv_make_object(a, 4);
+    for (int i = 0; i < 4; i++) jv_set(a, &ops, names[i], jv_make_int(a, get_i64(r)));
+    return ops;
+}
+
+static int read_step(TraceBinReader* r, Arena* a, JVal* out) {
+    if (!need(r, 5)) return bin_fail(r, "truncated step");
+    unsigned flags = get_u8(r);
+    *out = jv_make_object(a, 8);
+    if (flags & TRACE_STEP_KEYFRAME) {
+        JVal kf = {0};
+        kf.type = JV_BOOL;
+        kf.text = "true";
+        jv_set(a, out, "keyframe", kf);
+    }
+
+    unsigned count = get_u32(r);
+    JVal arrays = jv_make_object(a, count);
+    for (unsigned i = 0; i < count; i++) {
+        if (read_array(r, a, &arrays) < 0) return -1;
+    }
+    jv_set(a, out, "arrays", arrays);
+
+    JVal vars, highlights;
+    if (read_named_ints(r, a, &vars) < 0) return -1;
+    jv_set(a, out, "variables", vars);
+    if (read_named_ints(r, a, &highlights) < 0) return -1;
+    jv_set(a, out, "highlights", highlights);
+
+    if (!need(r, 4)) return bin_fail(r, "truncated step");
+    count = get_u32(r);
+    if (!need(r, (size_t)count * 8)) return bin_fail(r, "truncated step");
+    JVal nodes = jv_make_array(a, count);
+    for (unsigned i = 0; i < count; i++) {
+        JVal node = jv_make_object(a, 2);
+        jv_set(a, &node, "id", jv_make_int(a, (int)get_u32(r)));
+        char* label = string_ref(r, get_u32(r));
+        if (label == NULL) return -1;
+        jv_set(a, &node, "label", jv_make_string(label));
+        jv_push(a, &nodes, node);
+    }
+    jv_set(a, out, (r->flags & TRACE_FLAG_DELTA) ? "nodes_added" : "nodes", nodes);
+
+    if (!need(r, 4)) return bin_fail(r, "truncated step");
+    count = get_u32(r);
+    if (!need(r, (size_t)count * 8 + 4)) return bin_fail(r, "truncated step");
+    JVal edges = jv_make_array(a, count);
+    for (unsigned i = 0; i < count; i++) {
+        JVal edge = jv_make_object(a, 2);
+        jv_set(a, &edge, "from", jv_make_int(a, (int)get_u32(r)));
+        jv_set(a, &edge, "to", jv_make_int(a, (int)get_u32(r)));
+        jv_push(a, &edges, edge);
+    }
+    jv_set(a, out, (r->flags & TRACE_FLAG_DELTA) ? "edges_added" : "edges", edges);
+
+    char* message = string_ref(r, get_u32(r));
+    if (message == NULL) return -1;
+    if (flags & TRACE_STEP_TEMPLATE) {
+        message = read_template_args(r, a, message);
+        if (message == NULL) return -1;
+    }
+    jv_set(a, out, "message", jv_make_string(message));
+
+    if (flags & TRACE_STEP_OPS) {
+        if (!need(r, 64)) return bin_fail(r, "truncated step");
+        jv_set(a, out, "ops", read_ops(r, a));
+        jv_set(a, out, "ops_total", read_ops(r, a));
+    }
+    if (flags & TRACE_STEP_TIMING) {
+        if (!need(r, 16)) return bin_fail(r, "truncated step");
+        JVal timing = jv_make_object(a, 2);
+        jv_set(a, &timing, "start_ns", jv_make_int(a, get_i64(r)));
+        jv_set(a, &timing, "algorithm_ns", jv_make_int(a, get_i64(r)));
+        jv_set(a, out, "timing", timing);
+    }
+    return 0;
+}
+
+// The summary comes back as {"summary": {...}}, as in the JSON format.
+static int read_summary(TraceBinReader* r, Arena* a, JVal* out) {
+    if (!need(r, 4)) return bin_fail(r, "truncated summary");
+    unsigned count = get_u32(r);
+    if (!need(r, (size_t)count * 12)) return bin_fail(r, "truncated summary");
+    JVal fields = jv_make_object(a, count);
+    for (unsigned i = 0; i < count; i++) {
+        char* name = string_ref(r, get_u32(r));
+        if (name == NULL) return -1;
+        jv_set(a, &fields, name, jv_make_int(a, get_i64(r)));
+    }
+    *out = jv_make_object(a, 1);
+    jv_set(a, out, "summary", fields);
+    return 0;
+}
+
+int trace_bin_next(TraceBinReader* r, Arena* arena, JVal* out) {
+    for (;;) {
+        // A trace cut short (e.g. the program was killed) simply ends here.
+        if (!need(r, 1)) return 0;
+        unsigned tag = get_u8(r);
+        if (tag == TRACE_REC_END) return 0;
+        if (tag == TRACE_REC_STRING) {
+            if (read_string_record(r) < 0) return -1;
+            continue;
+        }
+        if (tag == TRACE_REC_STEP) return read_step(r, arena, out) < 0 ? -1 : 1;
+        if (tag == TRACE_REC_SUMMARY) return read_summary(r, arena, out) < 0 ? -1 : 1;
+        return bin_fail(r, "unknown record tag");
+    }
+}
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+// tracecat: decodes a logger trace back into the full JSON format.
+// Usage: tracecat [--step N] [file]
+//   Reads a JSON, NDJSON or binary trace, delta-encoded or not,
+//   from file (or stdin) and writes the full JSON trace, or with --step only
+//   the rebuilt state of step N (0-based).
+
+static char* read_all(FILE* in, size_t* len) {
+    size_t cap = 1 << 16;
+    size_t n = 0;
+    char* buf = malloc(cap);
+    size_t got;
+    while (buf != NULL && (got = fread(buf + n, 1, cap - n, in)) > 0) {
+        n += got;
+        if (n == cap) {
+            cap *= 2;
+            buf = realloc(buf, cap);
+        }
+    }
+    *len = n;
+    return buf;
+}
+
+int main(int argc, char* argv[]) {
+    long target = -1;
+    const char* path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--step") == 0 && i + 1 < argc) {
+            target = atol(argv[++i]);
+        } else {
+            path = argv[i];
+        }
+    }
+
+    FILE* in = path ? fopen(path, "rb") : stdin;
+    if (in == NULL) {
+        perror(path);
+        return 1;
+    }
+    size_t len;
+    char* buf = read_all(in, &len);
+    if (in != stdin) fclose(in);
+    if (buf == NULL) {
+        fprintf(stderr, "tracecat: out of memory\n");
+        return 1;
+    }
+
+    TraceReader reader;
+    TraceBinReader bin_reader;
+    int binary = trace_is_binary(buf, len);
+    TraceReplay replay;
+    Arena arena = {0};
+    JVal step;
+    long printed = 0;
+    int status = 0;
+    int rc;
+
+    trace_reader_init(&reader, buf, len);
+    if (binary && trace_bin_init(&bin_reader, buf, len) < 0) {
+        fprintf(stderr, "tracecat: %s\n", bin_reader.error);
+        free(buf);
+        return 1;
+    }
+    trace_replay_init(&replay);
+
+    if (target < 0) printf("[\n");
+    while ((rc = binary ? trace_bin_next(&bin_reader, &arena, &step)
+                        : trace_reader_next(&reader, &arena, &step)) > 0) {
+        long index = replay.step;
+        if (trace_replay_apply(&replay, &arena, &step) < 0) {
+            fprintf(stderr, "tracecat: step %ld refers to an array with no prior state\n", index);
+            status = 1;
+            break;
+        }
+        if (target < 0) {
+            if (printed++) printf(",\n");
+            trace_print_step(stdout, &step);
+        } else if (replay.step > index && index == target) {
+            trace_print_step(stdout, &step);
+            printf("\n");
+            break;
+        }
+        arena_reset(&arena);
+    }
+    if (rc < 0) {
+        fprintf(stderr, "tracecat: parse error at byte %zu: %s\n",
+                binary ? bin_reader.pos : reader.pos, binary ? bin_reader.error : reader.error);
+        status = 1;
+    } else if (target < 0) {
+        printf("\n]\n");
+    } else if (replay.step <= target && status == 0) {
+        fprintf(stderr, "tracecat: trace has only %ld steps\n", replay.step);
+        status = 1;
+    }
+
+    if (binary) trace_bin_free(&bin_reader);
+    trace_replay_free(&replay);
+    arena_free(&arena);
+    free(buf);
+    return status;
+}
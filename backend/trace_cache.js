@@ -0,0 +1,143 @@
+const crypto = require('crypto');
+const fs = require('fs');
+const path = require('path');
+
+// Content-addressed cache of program output. Keys are hashes of everything
+// the output depends on (see traceKey()); values are the trace bytes exactly
+// as the program wrote them. Two tiers, both least-recently-used and bounded
+// in bytes: memory, and a directory of files that survives restarts.
+
+function traceKey(...parts) {
+    return crypto.createHash('sha256').update(JSON.stringify(parts)).digest('hex');
+}
+
+// Map kept in recency order (oldest first), with a byte total.
+class LruIndex {
+    constructor(maxBytes) {
+        this.maxBytes = maxBytes;
+        this.bytes = 0;
+        this.entries = new Map();
+    }
+
+    get(key) {
+        const value = this.entries.get(key);
+        if (value !== undefined) {
+            this.entries.delete(key);
+            this.entries.set(key, value);
+        }
+        return value;
+    }
+
+    // Adds an entry; returns the [key, value] pairs evicted to make room.
+    set(key, value, size) {
+        this.delete(key);
+        this.entries.set(key, { value, size });
+        this.bytes += size;
+        const evicted = [];
+        for (const [oldKey, old] of this.entries) {
+            if (this.bytes <= this.maxBytes) break;
+            this.delete(oldKey);
+            evicted.push([oldKey, old.value]);
+        }
+        return evicted;
+    }
+
+    delete(key) {
+        const old = this.entries.get(key);
+        if (old === undefined) return;
+        this.entries.delete(key);
+        this.bytes -= old.size;
+    }
+}
+
+class TraceCache {
+    constructor({ dir, memoryBytes, diskBytes }) {
+        this.dir = dir;
+        this.memory = new LruIndex(memoryBytes);
+        this.disk = new LruIndex(diskBytes);
+        this.writing = new Set(); // keys being written to disk
+        this.counters = { memory_hits: 0, disk_hits: 0, misses: 0, memory_evictions: 0, disk_evictions: 0 };
+
+        // Pick up what earlier runs left, oldest first; drop unfinished writes.
+        fs.mkdirSync(dir, { recursive: true });
+        const names = fs.readdirSync(dir);
+        names.filter(name => name.endsWith('.tmp')).forEach(name => fs.unlink(path.join(dir, name), () => {}));
+        names
+            .filter(name => name.endsWith('.trace'))
+            .map(name => ({ name, stat: fs.statSync(path.join(dir, name)) }))
+            .sort((a, b) => a.stat.mtimeMs - b.stat.mtimeMs)
+            .forEach(({ name, stat }) => this.evictFiles(this.disk.set(name.slice(0, -6), true, stat.size)));
+    }
+
+    file(key) {
+        return path.join(this.dir, `${key}.trace`);
+    }
+
+    evictFiles(evicted) {
+        for (const [key] of evicted) {
+            this.counters.disk_evictions++;
+            fs.unlink(this.file(key), () => {});
+        }
+    }
+
+    // Resolves with { data, tier: 'memory' | 'disk' }, or null on a miss.
+    async get(key) {
+        const entry = this.memory.get(key);
+        if (entry !== undefined) {
+            this.counters.memory_hits++;
+            return { data: entry.value, tier: 'memory' };
+        }
+        if (this.disk.get(key) !== undefined) {
+            try {
+                const data = await fs.promises.readFile(this.file(key));
+                this.counters.disk_hits++;
+                this.putMemory(key, data);
+                return { data, tier: 'disk' };
+            } catch {
+                this.disk.delete(key); // removed behind our back
+            }
+        }
+        this.counters.misses++;
+        return null;
+    }
+
+    putMemory(key, data) {
+        // An entry bigger than a quarter of the memory tier would flush most
+        // of it; such traces are only kept on disk.
+        if (data.length > this.memory.maxBytes / 4) return;
+        this.counters.memory_evictions += this.memory.set(key, data, data.length).length;
+    }
+
+    put(key, data) {
+        this.putMemory(key, data);
+        // Concurrent runs of one trace (streamed runs are not
+        // single-flighted) write it once
+        if (data.length > this.disk.maxBytes || this.disk.entries.has(key) || this.writing.has(key)) return;
+        this.writing.add(key);
+        // Write to a temporary name and rename, so a crash never leaves a
+        // truncated trace under a valid key.
+        const file = this.file(key);
+        const tmp = `${file}.${process.pid}.tmp`;
+        fs.promises.writeFile(tmp, data)
+            .then(() => fs.promises.rename(tmp, file))
+            .then(() => this.evictFiles(this.disk.set(key, true, data.length)))
+            .catch(err => console.error('Trace cache write failed:', err.message))
+            .finally(() => this.writing.delete(key));
+    }
+
+    stats() {
+        const lookups = this.counters.memory_hits + this.counters.disk_hits + this.counters.misses;
+        return {
+            ...this.counters,
+            hit_ratio: lookups ? (this.counters.memory_hits + this.counters.disk_hits) / lookups : 0,
+            memory_entries: this.memory.entries.size,
+            memory_bytes: this.memory.bytes,
+            memory_max_bytes: this.memory.maxBytes,
+            disk_entries: this.disk.entries.size,
+            disk_bytes: this.disk.bytes,
+            disk_max_bytes: this.disk.maxBytes
+        };
+    }
+}
+
+module.exports = { TraceCache, LruIndex, traceKey };
@@ -0,0 +1,158 @@
+const fs = require('fs');
+const path = require('path');
+const { LruIndex } = require('./trace_cache');
+
+// Traces kept on disk for ranged reads. Each one is two files:
+//   <id>.ndjson  the program's LOG_FORMAT=ndjson output: one step per line,
+//                then the {"summary": ...} line
+//   <id>.idx     the byte offset of every step line and of the end of the
+//                last one, as u64 little-endian (steps + 1 entries)
+// so steps [from, from + count) are one read of the index and one read of
+// the trace, however long the trace is. Bounded in bytes, least recently
+// used first out; kept across restarts.
+
+const SUMMARY_PREFIX = Buffer.from('{"summary"');
+
+class TraceStore {
+    constructor({ dir, maxBytes }) {
+        this.dir = dir;
+        this.traces = new LruIndex(maxBytes);
+
+        fs.mkdirSync(dir, { recursive: true });
+        const names = fs.readdirSync(dir);
+        names.filter(name => name.endsWith('.tmp')).forEach(name => fs.unlink(path.join(dir, name), () => {}));
+        names
+            .filter(name => name.endsWith('.idx'))
+            .map(name => name.slice(0, -4))
+            .map(id => {
+                const trace = fs.statSync(this.file(id, 'ndjson'), { throwIfNoEntry: false });
+                const index = fs.statSync(this.file(id, 'idx'));
+                return { id, index, size: trace ? trace.size + index.size : 0 };
+            })
+            .filter(({ size }) => size > 0)
+            .sort((a, b) => a.index.mtimeMs - b.index.mtimeMs)
+            .forEach(({ id, index, size }) => this.evict(this.traces.set(id, index.size / 8 - 1, size)));
+    }
+
+    file(id, extension) {
+        return path.join(this.dir, `${id}.${extension}`);
+    }
+
+    evict(evicted) {
+        for (const [id] of evicted) {
+            fs.unlink(this.file(id, 'idx'), () => {});
+            fs.unlink(this.file(id, 'ndjson'), () => {});
+        }
+    }
+
+    has(id) {
+        return this.traces.entries.has(id);
+    }
+
+    // Starts storing a trace under id: write() its NDJSON output as it comes,
+    // then commit() (or abort()). Lines are indexed as they go by, so
+    // nothing is held here but the offsets.
+    create(id) {
+        const store = this;
+        const tmp = `.${process.pid}.${Date.now()}.tmp`;
+        const traceTmp = this.file(id, 'ndjson') + tmp;
+        const out = fs.createWriteStream(traceTmp);
+        const offsets = [0];
+        let size = 0;
+
+        return {
+            size: () => size,
+            // Returns false when the caller should wait for onDrain()
+            write(chunk) {
+                for (let i = chunk.indexOf(10); i >= 0; i = chunk.indexOf(10, i + 1)) {
+                    offsets.push(size + i + 1);
+                }
+                size += chunk.length;
+                return out.write(chunk);
+            },
+            onDrain(callback) {
+                out.once('drain', callback);
+            },
+            async commit() {
+                await new Promise((resolve, reject) => out.end(err => (err ? reject(err) : resolve())));
+                // The last complete line is the summary when it starts so
+                // (it always does with LOG_MAX_STEPS set); it is not a step.
+                const last = offsets.length - 2;
+                if (last >= 0) {
+                    const head = Buffer.alloc(SUMMARY_PREFIX.length);
+                    const file = await fs.promises.open(traceTmp, 'r');
+                    await file.read(head, 0, head.length, offsets[last]);
+                    await file.close();
+                    if (head.equals(SUMMARY_PREFIX)) offsets.pop();
+                }
+                const index = Buffer.alloc(offsets.length * 8);
+                offsets.forEach((offset, i) => index.writeBigUInt64LE(BigInt(offset), i * 8));
+                const indexTmp = store.file(id, 'idx') + tmp;
+                await fs.promises.writeFile(indexTmp, index);
+                // The index goes last: a trace exists once its index does.
+                await fs.promises.rename(traceTmp, store.file(id, 'ndjson'));
+                await fs.promises.rename(indexTmp, store.file(id, 'idx'));
+                store.evict(store.traces.set(id, offsets.length - 1, size + index.length));
+                return offsets.length - 1;
+            },
+            abort() {
+                out.destroy();
+                fs.unlink(traceTmp, () => {});
+            }
+        };
+    }
+
+    // Resolves with { total, steps, summary }: the number of steps, the
+    // JSON text of steps [from, from + count) as the elements of an array
+    // (no brackets), and, when asked for, the summary line's JSON text.
+    // Resolves with null for an unknown id.
+    async read(id, from, count, { summary = false } = {}) {
+        const entry = this.traces.get(id);
+        if (entry === undefined) return null;
+        const total = entry.value;
+        const end = Math.min(total, from + count);
+        const result = { total, steps: '', summary: null };
+        let index, trace;
+        try {
+            index = await fs.promises.open(this.file(id, 'idx'), 'r');
+            trace = await fs.promises.open(this.file(id, 'ndjson'), 'r');
+        } catch (err) {
+            await index?.close();
+            if (err.code !== 'ENOENT') throw err;
+            this.traces.delete(id); // evicted while this read started
+            return null;
+        }
+        try {
+            if (from < end) {
+                const offsets = Buffer.alloc((end - from + 1) * 8);
+                await index.read(offsets, 0, offsets.length, from * 8);
+                const start = Number(offsets.readBigUInt64LE(0));
+                const stop = Number(offsets.readBigUInt64LE(offsets.length - 8));
+                const text = Buffer.alloc(stop - start);
+                await trace.read(text, 0, text.length, start);
+                // One step per line: the newlines become the commas
+                for (let i = text.indexOf(10); i >= 0 && i < text.length - 1; i = text.indexOf(10, i + 1)) {
+                    text[i] = 44;
+                }
+                result.steps = text.toString('utf8', 0, text.length - 1);
+            }
+            if (summary) {
+                const last = Buffer.alloc(8);
+                await index.read(last, 0, 8, total * 8);
+                const { size } = await trace.stat();
+                const text = Buffer.alloc(size - Number(last.readBigUInt64LE(0)));
+                await trace.read(text, 0, text.length, Number(last.readBigUInt64LE(0)));
+                result.summary = text.toString().trim() || null;
+            }
+        } finally {
+            await Promise.all([index.close(), trace.close()]);
+        }
+        return result;
+    }
+
+    stats() {
+        return { traces: this.traces.entries.size, bytes: this.traces.bytes, max_bytes: this.traces.maxBytes };
+    }
+}
+
+module.exports = { TraceStore };
@@ -3,11 +3,26 @@ import { Card, Button } from './ui/common';
 import { VisualizerEngine } from './VisualizerEngine';
 import { Play, Pause, SkipBack, SkipForward, RefreshCw, ArrowLeft, Loader2, AlertCircle, Settings, Clock, Boxes, Code, ChevronDown, ChevronUp, Gauge, BookOpen } from 'lucide-react';
 import { GuidedTutorial } from './GuidedTutorial';
+import { createTraceReplay } from '../traceReplay';
+
+// Traces are stored by the backend and fetched a page at a time: playback
+// starts with the first page, and the next one is requested once the
+// playhead gets within PREFETCH_AHEAD steps of the end of what is loaded.
+// Stored steps are delta-encoded; pages are replayed into full steps as
+// they arrive, in order.
+const PAGE_STEPS = 200;
+const PREFETCH_AHEAD = 100;
 
 export function InterviewMode({ problem, onBack }) {
+    // The steps loaded so far (a prefix of the trace) and the trace's length
     const [logs, setLogs] = useState([]);
+    const [totalSteps, setTotalSteps] = useState(0);
+    const traceIdRef = useRef(null);
+    const pageRequestRef = useRef(null);
+    const replayRef = useRef(null); // { replay, length }: the steps replayed so far
     const [currentStep, setCurrentStep] = useState(0);
     const [isPlaying, setIsPlaying] = useState(false);
+    const [nextQueued, setNextQueued] = useState(false); // Next pressed on the last loaded step
     const [isLoading, setIsLoading] = useState(false);
     const [error, setError] = useState(null);
     const [speed, setSpeed] = useState(1); // 1x speed by default
@@ -56,6 +71,8 @@ export function InterviewMode({ problem, onBack }) {
             timerRef.current = setInterval(() => {
                 setCurrentStep(prev => {
                     if (prev < logs.length - 1) return prev + 1;
+                    // Wait for the next page unless this is the end
+                    if (logs.length < totalSteps) return prev;
                     setIsPlaying(false);
                     return prev;
                 });
@@ -64,12 +81,47 @@ export function InterviewMode({ problem, onBack }) {
             clearInterval(timerRef.current);
         }
         return () => clearInterval(timerRef.current);
-    }, [isPlaying, logs.length, isLoading, error, speed]);
+    }, [isPlaying, logs.length, totalSteps, isLoading, error, speed]);
+
+    // Prefetch the page after the loaded steps
+    useEffect(() => {
+        const id = traceIdRef.current;
+        const from = logs.length;
+        if (!id || from >= totalSteps || from - currentStep > PREFETCH_AHEAD) return;
+        const request = `${id}:${from}`;
+        if (pageRequestRef.current === request) return;
+        pageRequestRef.current = request;
+
+        fetch(`http://localhost:3001/trace/${id}?from=${from}&count=${PAGE_STEPS}`)
+            .then(response => {
+                if (!response.ok) throw new Error(`Failed to load steps: ${response.statusText}`);
+                return response.json();
+            })
+            .then(page => {
+                if (traceIdRef.current !== id || replayRef.current.length !== page.from) return;
+                const steps = page.steps.map(replayRef.current.replay);
+                replayRef.current.length += steps.length;
+                setLogs(prev => prev.concat(steps));
+            })
+            .catch(err => {
+                console.error("Page Error:", err);
+                pageRequestRef.current = null; // retried on the next step or Next press
+            });
+    }, [currentStep, logs.length, totalSteps, nextQueued]);
+
+    // A queued Next goes through once the next page is in
+    useEffect(() => {
+        if (nextQueued && currentStep < logs.length - 1) {
+            setNextQueued(false);
+            setCurrentStep(c => c + 1);
+        }
+    }, [nextQueued, currentStep, logs.length]);
 
     const handleRun = async (values = inputValues) => {
         setIsLoading(true);
         setError(null);
         setIsPlaying(false);
+        setNextQueued(false);
 
         try {
             // Prepare inputs for API
@@ -92,10 +144,10 @@ export function InterviewMode({ problem, onBack }) {
                 });
             }
 
-            const response = await fetch(`http://localhost:3001/run/${problem.id}`, {
+            const response = await fetch(`http://localhost:3001/trace/${problem.id}`, {
                 method: 'POST',
                 headers: { 'Content-Type': 'application/json' },
-                body: JSON.stringify({ inputs: apiInputs })
+                body: JSON.stringify({ inputs: apiInputs, count: PAGE_STEPS })
             });
 
             if (!response.ok) {
@@ -103,40 +155,57 @@ export function InterviewMode({ problem, onBack }) {
                 throw new Error(errorData.error || `Failed to execute: ${response.statusText}`);
             }
 
-            const data = await response.json();
-            if (!Array.isArray(data) || data.length === 0) {
+            // The first page of the stored trace: { id, total, from, steps }
+            const page = await response.json();
+            if (page.total === 0) {
                 // If it's empty, maybe just finished? Or error?
                 // For visualization we generally expect steps.
                 console.warn("No steps returned");
             }
-            setLogs(data);
+            traceIdRef.current = page.id;
+            pageRequestRef.current = null;
+            const replay = createTraceReplay();
+            const steps = page.steps.map(replay);
+            replayRef.current = { replay, length: steps.length };
+            setLogs(steps);
+            setTotalSteps(page.total);
             setCurrentStep(0);
 
         } catch (err) {
             console.error("Run Error:", err);
             setError(err.message);
+            traceIdRef.current = null;
             setLogs([]);
+            setTotalSteps(0);
         } finally {
             setIsLoading(false);
         }
     };
 
+    // The Next button is enabled up to the last step of the whole trace, so
+    // past the loaded steps the advance waits for the next page.
     const handleNext = () => {
         setIsPlaying(false);
         if (currentStep < logs.length - 1) setCurrentStep(c => c + 1);
+        else if (logs.length < totalSteps) setNextQueued(true);
     };
 
     const handlePrev = () => {
         setIsPlaying(false);
+        setNextQueued(false);
         if (currentStep > 0) setCurrentStep(c => c - 1);
     };
 
     const handleReset = () => {
         setIsPlaying(false);
+        setNextQueued(false);
         setCurrentStep(0);
     };
 
-    const togglePlay = () => setIsPlaying(!isPlaying);
+    const togglePlay = () => {
+        setNextQueued(false);
+        setIsPlaying(!isPlaying);
+    };
 
     const handleInputChange = (name, value) => {
         setInputValues(prev => ({ ...prev, [name]: value }));
@@ -181,7 +250,7 @@ export function InterviewMode({ problem, onBack }) {
 
         window.addEventListener('keydown', handleKeyDown);
         return () => window.removeEventListener('keydown', handleKeyDown);
-    }, [isPlaying, currentStep, logs.length]);
+    }, [isPlaying, currentStep, logs.length, totalSteps]);
 
     const handleTutorialAction = (action) => {
         if (action === 'run') {
@@ -577,7 +646,7 @@ export function InterviewMode({ problem, onBack }) {
                             </div>
                         ) : (
                             <div className="font-mono text-sm text-[var(--color-text-secondary)] bg-[var(--color-bg-tertiary)] px-3 py-1 rounded-md border border-[var(--color-border)]">
-                                Step <span className="text-[var(--color-text-primary)]">{currentStep + 1}</span> / {logs.length}
+                                Step <span className="text-[var(--color-text-primary)]">{currentStep + 1}</span> / {totalSteps}
                             </div>
                         )}
                     </div>
@@ -658,7 +727,7 @@ export function InterviewMode({ problem, onBack }) {
                         <Button 
                             variant="ghost" 
                             onClick={handleNext} 
-                            disabled={currentStep === logs.length - 1} 
+                            disabled={currentStep >= totalSteps - 1} 
                             className="hover:bg-[var(--color-bg-tertiary)]"
                             title="Next step (Right Arrow)"
                             aria-label="Go to next step"
@@ -52,16 +52,22 @@ export function VisualizerEngine({ step }) {
                                 const isChild = new Set(edges.map(e => e.to));
                                 const roots = nodes.filter(n => !isChild.has(n.id));
 
-                                // Simple DFS to assign levels
+                                // Simple DFS to assign levels (linear: trees
+                                // from long traces have many thousands of nodes)
+                                const placed = new Set();
                                 const assignLevels = (id, level) => {
                                     if (!levelMap[level]) levelMap[level] = [];
-                                    if (!levelMap[level].includes(id)) levelMap[level].push(id);
-                                    adj[id].forEach(childId => assignLevels(childId, level + 1));
+                                    const key = `${level}:${id}`;
+                                    if (!placed.has(key)) {
+                                        placed.add(key);
+                                        levelMap[level].push(id);
+                                    }
+                                    (adj[id] || []).forEach(childId => assignLevels(childId, level + 1));
                                 };
                                 roots.forEach(r => assignLevels(r.id, 0));
 
                                 // Calculate coordinates
-                                const levels = Object.keys(levelMap).length;
+                                const nodeById = new Map(nodes.map(n => [n.id, n]));
                                 Object.entries(levelMap).forEach(([lvl, nodeIds]) => {
                                     const levelInt = parseInt(lvl);
                                     const y = 50 + levelInt * 60;
@@ -91,7 +97,7 @@ export function VisualizerEngine({ step }) {
                                         })}
                                         {/* Render Nodes */}
                                         {Object.entries(nodeCoords).map(([id, coords]) => {
-                                            const node = nodes.find(n => n.id === parseInt(id));
+                                            const node = nodeById.get(parseInt(id));
                                             return (
                                                 <g key={`rec-node-${id}`}>
                                                     <circle
@@ -0,0 +1,38 @@
+import { describe, it, expect } from 'vitest';
+import { createTraceReplay } from '../traceReplay';
+
+describe('Trace replay', () => {
+  it('applies array changes between keyframes', () => {
+    const replay = createTraceReplay();
+    const steps = [
+      { keyframe: true, arrays: { 'Sort Array': [5, 3, 8] }, message: 'start' },
+      { arrays: { 'Sort Array': { set: [0, 3, 1, 5] } }, message: 'swap' },
+      { arrays: { 'Sort Array': { set: [] } }, message: 'compare' },
+      { keyframe: true, arrays: { 'Sort Array': [3, 5, 8] }, message: 'keyframe' },
+    ].map(replay);
+
+    expect(steps.map(s => s.arrays['Sort Array'])).toEqual([[5, 3, 8], [3, 5, 8], [3, 5, 8], [3, 5, 8]]);
+    expect(steps[0].arrays['Sort Array']).toEqual([5, 3, 8]);
+    expect(steps[1].message).toBe('swap');
+    expect(steps[1]).not.toHaveProperty('keyframe');
+  });
+
+  it('gives every step the tree as of its end', () => {
+    const replay = createTraceReplay();
+    const steps = [
+      { keyframe: true, arrays: {}, nodes_added: [{ id: 0, label: 'fib(2)' }], edges_added: [] },
+      { arrays: {}, nodes_added: [{ id: 1, label: 'fib(1)' }], edges_added: [{ from: 0, to: 1 }] },
+      { arrays: {}, nodes_added: [], edges_added: [] },
+    ].map(replay);
+
+    expect(steps.map(s => s.nodes.length)).toEqual([1, 2, 2]);
+    expect(steps[0].edges).toEqual([]);
+    expect(steps[2].edges).toEqual([{ from: 0, to: 1 }]);
+    expect(steps[2]).not.toHaveProperty('nodes_added');
+  });
+
+  it('rejects a change to an array it has not seen', () => {
+    const replay = createTraceReplay();
+    expect(() => replay({ arrays: { A: { set: [0, 1] } } })).toThrow();
+  });
+});
@@ -0,0 +1,48 @@
+// Replays delta-encoded trace steps (LOG_DELTA=1, see
+// backend/include/logger.h) into full steps, which must be fed in trace
+// order from the first one:
+//   - a keyframe carries every array in full; in between, an array that
+//     changed comes as {"set": [index, value, ...]} against its last value
+//   - tree nodes and edges only ever get added, so "nodes_added" and
+//     "edges_added" are appended to one list for the whole trace, and each
+//     step sees the prefix that existed at its end. Steps share the list
+//     rather than each holding a copy: a recursion tree can have hundreds
+//     of thousands of nodes.
+export function createTraceReplay() {
+    const arrays = new Map();
+    const nodes = [];
+    const edges = [];
+
+    return function replay(step) {
+        const { keyframe, nodes_added, edges_added, ...rest } = step;
+        if (keyframe) arrays.clear();
+
+        const full = {};
+        for (const [name, value] of Object.entries(step.arrays || {})) {
+            if (Array.isArray(value)) {
+                arrays.set(name, value);
+                full[name] = value;
+                continue;
+            }
+            const last = arrays.get(name);
+            if (!last) throw new Error(`Step changes array '${name}' before it was sent in full`);
+            const next = last.slice();
+            const set = value.set || [];
+            for (let i = 0; i + 1 < set.length; i += 2) next[set[i]] = set[i + 1];
+            arrays.set(name, next);
+            full[name] = next;
+        }
+
+        for (const node of nodes_added || []) nodes.push(node);
+        for (const edge of edges_added || []) edges.push(edge);
+        const nodeCount = nodes.length;
+        const edgeCount = edges.length;
+
+        const result = { ...rest, arrays: full };
+        Object.defineProperties(result, {
+            nodes: { get: () => nodes.slice(0, nodeCount), enumerable: true },
+            edges: { get: () => edges.slice(0, edgeCount), enumerable: true }
+        });
+        return result;
+    };
+}